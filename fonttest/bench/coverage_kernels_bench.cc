@@ -0,0 +1,89 @@
+// Measures the coverage resolve kernels, in bytes of the accumulation buffer
+// per cycle.
+//
+// Usage: coverage_kernels_bench
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "coverage_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLE_UNIT "cycle"
+#else
+#define CYCLE_UNIT "ns"
+#endif
+
+namespace {
+
+uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Cells as the lines of a glyph would leave them: the cover enters and
+// leaves each row at random cells.
+void fillCells(int width, int height, std::vector<float>* cells) {
+  cells->assign(width * height, 0.0f);
+  srand(1);
+  for (int y = 0; y < height; ++y) {
+    for (int k = 0; k < 4; ++k) {
+      int x0 = rand() % width;
+      int x1 = x0 + rand() % (width - x0);
+      float d = (rand() % 1000) / 1000.0f;
+      (*cells)[y * width + x0] += d;
+      (*cells)[y * width + x1] -= d;
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const int kSizes[] = { 16, 64, 256, 1024 };
+  const size_t kBytesPerRun = 64 << 20;
+  const int kRepeat = 5;
+
+  std::vector<CoverageKernel> kernels = supportedCoverageKernels();
+  printf("selected kernel: %s\n", coverageKernel().name);
+  printf("%-8s %10s %16s\n", "kernel", "size", "bytes/" CYCLE_UNIT);
+
+  for (int size : kSizes) {
+    std::vector<float> cells;
+    fillCells(size, size, &cells);
+    const size_t n = cells.size();
+    const size_t bytes = n * sizeof(float);
+    const size_t iterations = kBytesPerRun / bytes + 1;
+
+    std::vector<uint8_t> expected(n);
+    accumulateScalar(&cells[0], &expected[0], n);
+
+    for (const CoverageKernel& kernel : kernels) {
+      std::vector<uint8_t> out(n);
+      uint64_t best = UINT64_MAX;
+      for (int r = 0; r < kRepeat; ++r) {
+        uint64_t start = now();
+        for (size_t i = 0; i < iterations; ++i)
+          kernel.accumulate(&cells[0], &out[0], n);
+        uint64_t elapsed = now() - start;
+        if (elapsed < best)
+          best = elapsed;
+      }
+      if (memcmp(&out[0], &expected[0], n) != 0)
+        printf("%s: output differs from the scalar kernel\n", kernel.name);
+
+      printf("%-8s %4dx%-5d %16.3f\n", kernel.name, size, size,
+             (double)bytes * iterations / best);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,129 @@
+// Decodes the points of every simple glyph in a font with each coordinate
+// kernel, in cycles per point. The streaming decoder, which also emits the
+// path commands, is measured for comparison.
+//
+// Usage: glyf_decode_bench <font.ttf|font.ttc> [index]
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "font_face.h"
+#include "glyf.h"
+#include "glyf_kernels.h"
+#include "loca.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLE_UNIT "cycle"
+#else
+#define CYCLE_UNIT "ns"
+#endif
+
+namespace {
+
+uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Counts the path commands, which are printed so that the decoding is not
+// optimized away.
+struct CountingSink {
+  CountingSink() : commands(0) {}
+  void moveTo(int x, int y) { ++commands; }
+  void lineTo(int x, int y) { ++commands; }
+  void quadTo(int cx, int cy, int x, int y) { ++commands; }
+  void close() { ++commands; }
+  uint64_t commands;
+};
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <font> [index]\n", argv[0]);
+    return 1;
+  }
+  const int kRepeat = 5;
+  const int kIterations = 20;
+
+  FontFace face(argv[1], argc > 2 ? atoi(argv[2]) : 0);
+  const LocaSubTable* loca = &face.loca();
+  const GlyfSubTable* glyf = &face.glyf();
+
+  std::vector<uint32_t> offsets;
+  for (uint32_t id = 0; id < face.num_glyphs(); ++id) {
+    uint32_t offset = loca->findGlyfOffset(id);
+    GlyfData header;
+    if (offset != loca->findGlyfOffset(id + 1) &&
+        glyf->getGlyfHeader(offset, &header) && header.num_of_contours > 0)
+      offsets.push_back(offset);
+  }
+
+  std::vector<uint8_t> flags;
+  Outline outline;
+  std::vector<Outline> expected(offsets.size());
+  uint64_t points = 0;
+  for (size_t i = 0; i < offsets.size(); ++i) {
+    glyf->decodeOutline(offsets[i], supportedCoordinateKernels()[0], &flags,
+                        &expected[i]);
+    points += expected[i].numPoints();
+  }
+  printf("%zu simple glyphs, %llu points\n", offsets.size(),
+         (unsigned long long)points);
+  printf("selected kernel: %s\n", coordinateKernel().name);
+  printf("%-10s %16s\n", "decoder", CYCLE_UNIT "s/point");
+
+  for (const CoordinateKernel& kernel : supportedCoordinateKernels()) {
+    uint64_t best = UINT64_MAX;
+    for (int r = 0; r < kRepeat; ++r) {
+      uint64_t start = now();
+      for (int k = 0; k < kIterations; ++k) {
+        for (uint32_t offset : offsets)
+          glyf->decodeOutline(offset, kernel, &flags, &outline);
+      }
+      uint64_t elapsed = now() - start;
+      if (elapsed < best)
+        best = elapsed;
+    }
+
+    for (size_t i = 0; i < offsets.size(); ++i) {
+      glyf->decodeOutline(offsets[i], kernel, &flags, &outline);
+      if (outline.x != expected[i].x || outline.y != expected[i].y ||
+          outline.on_curve != expected[i].on_curve) {
+        printf("%s: glyph at 0x%x differs from the scalar kernel\n",
+               kernel.name, offsets[i]);
+        break;
+      }
+    }
+    printf("%-10s %16.3f\n", kernel.name, (double)best / points / kIterations);
+  }
+
+  uint64_t best = UINT64_MAX;
+  CountingSink sink;
+  for (int r = 0; r < kRepeat; ++r) {
+    uint64_t start = now();
+    for (int k = 0; k < kIterations; ++k) {
+      for (uint32_t offset : offsets)
+        glyf->decodeSimpleGlyf(offset, &sink);
+    }
+    uint64_t elapsed = now() - start;
+    if (elapsed < best)
+      best = elapsed;
+  }
+  printf("%-10s %16.3f\n", "streaming", (double)best / points / kIterations);
+  // Reading the count keeps the streaming loop from being optimized away.
+  printf("%llu path commands\n",
+         (unsigned long long)(sink.commands / kRepeat / kIterations));
+  return 0;
+}
@@ -0,0 +1,102 @@
+// Maps UTF-8 text to glyph ids through CmapIndex, in nanoseconds per byte,
+// against decoding and looking up one character or variation sequence at a
+// time in the cmap subtable.
+//
+// Usage: text_bench <font.ttf|font.ttc> <text file> [index]
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "cmap.h"
+#include "cmap_index.h"
+#include "font_face.h"
+#include "utf8.h"
+
+namespace {
+
+// Looks up one character or variation sequence at a time.
+void findGlyphIdsBySubtable(const CmapSubTable& cmap,
+                            const std::vector<uint32_t>& text,
+                            std::vector<uint32_t>* glyph_ids) {
+  glyph_ids->clear();
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (isVariationSelector(text[i]))
+      continue;
+    uint32_t glyph_id = (uint32_t)-1;
+    if (i + 1 < text.size() && isVariationSelector(text[i + 1]))
+      glyph_id = cmap.findGlyphId(text[i], text[i + 1]);
+    if (glyph_id == (uint32_t)-1)
+      glyph_id = cmap.findGlyphId(text[i], 0);
+    glyph_ids->push_back(glyph_id);
+  }
+}
+
+double nanosecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(
+      std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  if (argc < 3) {
+    fprintf(stderr, "Usage: %s <font> <text file> [index]\n", argv[0]);
+    return 1;
+  }
+  const int kRepeat = 5;
+
+  FontFace face(argv[1], argc > 3 ? atoi(argv[3]) : 0);
+  const CmapSubTable* cmap = &face.cmap();
+  std::ifstream file(argv[2], std::ios::binary);
+  std::string text((std::istreambuf_iterator<char>(file)),
+                   std::istreambuf_iterator<char>());
+  if (text.empty()) {
+    fprintf(stderr, "No text in %s\n", argv[2]);
+    return 1;
+  }
+
+  std::vector<uint32_t> code_points;
+  std::vector<uint32_t> expected;
+  decodeUtf8(text.data(), text.size(), &code_points);
+  findGlyphIdsBySubtable(*cmap, code_points, &expected);
+  printf("%zu bytes, %zu characters\n", text.size(), code_points.size());
+
+  // The pages are built in the first round.
+  CmapIndex index(*cmap);
+  double cold = 0;
+  double best = 1e300;
+  std::vector<uint32_t> glyph_ids;
+  for (int r = 0; r < kRepeat; ++r) {
+    auto start = std::chrono::steady_clock::now();
+    index.findGlyphIdsFromUtf8(text.data(), text.size(), &glyph_ids);
+    if (r == 0)
+      cold = nanosecondsSince(start);
+    else
+      best = std::min(best, nanosecondsSince(start));
+  }
+  if (glyph_ids != expected)
+    printf("The index differs from the cmap subtable.\n");
+  printf("%-12s %12.3f ns/byte\n", "cold index", cold / text.size());
+  printf("%-12s %12.3f ns/byte\n", "index", best / text.size());
+
+  best = 1e300;
+  for (int r = 0; r < kRepeat; ++r) {
+    auto start = std::chrono::steady_clock::now();
+    code_points.clear();
+    decodeUtf8(text.data(), text.size(), &code_points);
+    findGlyphIdsBySubtable(*cmap, code_points, &glyph_ids);
+    best = std::min(best, nanosecondsSince(start));
+  }
+  printf("%-12s %12.3f ns/byte\n", "subtable", best / text.size());
+  return 0;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The big-endian field types of the font tables. Each one is the bytes of the
+// field as stored in the font, so a record made of them can be laid over the
+// mapped table without copying, at any alignment. A read compiles into a
+// load and a byte swap.
+
+namespace big_endian_internal {
+
+template <size_t N>
+constexpr uint32_t load(const uint8_t* bytes) {
+  return load<N - 1>(bytes) << 8 | bytes[N - 1];
+}
+
+template <>
+constexpr uint32_t load<0>(const uint8_t* bytes) {
+  return 0;
+}
+
+}  // namespace big_endian_internal
+
+// |N| bytes holding a |T|.
+template <typename T, size_t N = sizeof(T)>
+struct BigEndian {
+  uint8_t bytes[N];
+
+  constexpr T value() const {
+    return (T)big_endian_internal::load<N>(bytes);
+  }
+  constexpr operator T() const { return value(); }
+};
+
+typedef BigEndian<uint8_t> UInt8;
+typedef BigEndian<uint16_t> UInt16;
+typedef BigEndian<int16_t> Int16;
+typedef BigEndian<uint32_t, 3> UInt24;
+typedef BigEndian<uint32_t> UInt32;
+typedef BigEndian<int32_t> Int32;
+
+typedef Int16 FWord;     // font units.
+typedef UInt16 UFWord;   // font units.
+typedef Int16 F2Dot14;   // 2.14 fixed point.
+typedef Int32 Fixed;     // 16.16 fixed point.
+typedef UInt16 Offset16;
+typedef UInt32 Offset32;
+typedef UInt32 Tag;
+
+static_assert(sizeof(UInt24) == 3 && alignof(UInt24) == 1,
+              "The fields must have the size of the stored bytes.");
+static_assert(sizeof(UInt32) == 4 && alignof(UInt32) == 1,
+              "The fields must have the size of the stored bytes.");
+
+// Returns the |T| at |offset| bytes of |ptr|.
+template <typename T>
+const T* recordAt(const void* ptr, size_t offset) {
+  return reinterpret_cast<const T*>((const uint8_t*)ptr + offset);
+}
+
+// Returns the |T| at |offset| bytes of |ptr|, or nullptr if |count| records
+// of |T| from there do not fit in |length| bytes.
+template <typename T>
+const T* recordAt(const void* ptr, size_t length, size_t offset,
+                  size_t count = 1) {
+  if (offset > length || count > (length - offset) / sizeof(T))
+    return nullptr;
+  return recordAt<T>(ptr, offset);
+}
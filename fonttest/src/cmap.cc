@@ -1,105 +1,249 @@
 #include "cmap.h"
 
-#include "utils.h"
-
 #include <glog/logging.h>
 
+namespace {
+
+struct CmapHeader {
+  UInt16 version;
+  UInt16 num_tables;
+};
+
+struct EncodingRecord {
+  UInt16 platform_id;
+  UInt16 encoding_id;
+  Offset32 offset;
+};
+
+struct UnicodeRange {
+  UInt24 start_unicode_value;
+  UInt8 additional_count;
+
+  uint32_t first() const { return start_unicode_value; }
+  uint32_t last() const { return first() + additional_count; }
+};
+
+struct UvsMapping {
+  UInt24 unicode_value;
+  UInt16 glyph_id;
+
+  uint32_t first() const { return unicode_value; }
+  uint32_t last() const { return first(); }
+};
+
+// Binary searches the |count| sorted |records| for the one covering |ch|.
+template <typename T>
+const T* findRecord(const T* records, uint32_t count, uint32_t ch) {
+  uint32_t lo = 0;
+  uint32_t hi = count;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (records[mid].last() < ch)
+      lo = mid + 1;
+    else if (ch < records[mid].first())
+      hi = mid;
+    else
+      return &records[mid];
+  }
+  return nullptr;
+}
+
+// Returns the array of UVS records at |offset| of the format 14 subtable, or
+// nullptr if there is none.
+template <typename T>
+const T* uvsRecords(const uint8_t* ptr, size_t length, uint32_t offset,
+                    uint32_t* count) {
+  const UInt32* num = recordAt<UInt32>(ptr, length, offset);
+  if (offset == 0 || !num)
+    return nullptr;
+  *count = *num;
+  return recordAt<T>(ptr, length, offset + sizeof(UInt32), *count);
+}
+
+}  // namespace
+
 CmapSubTable::CmapSubTable(const void* ptr, size_t length)
-    : format4_ptr_(nullptr), format12_ptr_(nullptr), format14_ptr_(nullptr) {
-  uint8_t* bytes = (uint8_t*)ptr;
-  uint32_t table_version = readU16(bytes, 0);
-  if (table_version != 0)
+    : format4_ptr_(nullptr), format4_length_(0), seg_count_(0),
+      groups_(nullptr), num_groups_(0), format14_ptr_(nullptr),
+      format14_length_(0), num_var_selectors_(0) {
+  const uint8_t* bytes = (const uint8_t*)ptr;
+  const CmapHeader* header = recordAt<CmapHeader>(ptr, length, 0);
+  if (!header || header->version != 0)
     LOG(FATAL) << "Invalid table version.";
-  uint32_t num_tables = readU16(bytes, 2);
+  uint32_t num_tables = header->num_tables;
   if (num_tables == 0)
     LOG(FATAL) << "Empty tables.";
+  const EncodingRecord* records = recordAt<EncodingRecord>(
+      ptr, length, sizeof(CmapHeader), num_tables);
+  if (!records)
+    LOG(FATAL) << "Invalid encoding records.";
 
   for (size_t i = 0; i < num_tables; ++i) {
-    const size_t kHeaderSize = 8;
-    uint32_t headerOffset =  4 + kHeaderSize * i;
-
-    uint32_t platform_id = readU16(bytes, headerOffset);
-    uint32_t encoding_id = readU16(bytes, headerOffset + 2);
-    uint32_t offset = readU32(bytes, headerOffset + 4);
+    uint32_t platform_id = records[i].platform_id;
+    uint32_t encoding_id = records[i].encoding_id;
+    uint32_t offset = records[i].offset;
 
     if (platform_id == 3 && encoding_id == 1) {
-      format4_ptr_ = (uint8_t*)ptr + offset;
+      initFormat4(bytes + offset, offset < length ? length - offset : 0);
     } else if (platform_id == 3 && encoding_id == 10) {
-      format12_ptr_ = (uint8_t*)ptr + offset;
-    } else if (platform_id == 0 && encoding_id == 15) {
-      format14_ptr_ =  (uint8_t*)ptr + offset;
+      initFormat12(bytes + offset, offset < length ? length - offset : 0);
+    } else if (platform_id == 0 && encoding_id == 5) {
+      initFormat14(bytes + offset, offset < length ? length - offset : 0);
     }
   }
 }
 
-uint32_t CmapSubTable::findGlyphId(uint32_t ch, uint32_t vs) {
+void CmapSubTable::initFormat4(const uint8_t* ptr, size_t length) {
+  const Format4Header* header = recordAt<Format4Header>(ptr, length, 0);
+  if (!header || header->format != 4) {
+    LOG(ERROR) << "Invalid format 4 subtable.";
+    return;
+  }
+  uint32_t seg_count = header->seg_count_x2 >> 1;
+  // endCode, reservedPad, startCode, idDelta and idRangeOffset.
+  const UInt16* arrays = recordAt<UInt16>(ptr, length, sizeof(Format4Header),
+                                          seg_count * 4 + 1);
+  if (!arrays) {
+    LOG(ERROR) << "Invalid format 4 subtable length.";
+    return;
+  }
+  format4_ptr_ = ptr;
+  format4_length_ = length;
+  seg_count_ = seg_count;
+  end_codes_ = arrays;
+  start_codes_ = end_codes_ + seg_count + 1;
+  id_deltas_ = start_codes_ + seg_count;
+  id_range_offsets_ = id_deltas_ + seg_count;
+}
+
+void CmapSubTable::initFormat12(const uint8_t* ptr, size_t length) {
+  const Format12Header* header = recordAt<Format12Header>(ptr, length, 0);
+  if (!header || header->format != 12) {
+    LOG(ERROR) << "Invalid format 12 subtable.";
+    return;
+  }
+  groups_ = recordAt<SequentialMapGroup>(ptr, length, sizeof(Format12Header),
+                                         header->num_groups);
+  if (!groups_) {
+    LOG(ERROR) << "Invalid format 12 subtable length.";
+    return;
+  }
+  num_groups_ = header->num_groups;
+}
+
+void CmapSubTable::initFormat14(const uint8_t* ptr, size_t length) {
+  const Format14Header* header = recordAt<Format14Header>(ptr, length, 0);
+  if (!header || header->format != 14) {
+    LOG(ERROR) << "Invalid format 14 subtable.";
+    return;
+  }
+  var_selectors_ = recordAt<VariationSelector>(
+      ptr, length, sizeof(Format14Header), header->num_var_selector_records);
+  if (!var_selectors_) {
+    LOG(ERROR) << "Invalid format 14 subtable length.";
+    return;
+  }
+  format14_ptr_ = ptr;
+  format14_length_ = length;
+  num_var_selectors_ = header->num_var_selector_records;
+}
+
+uint32_t CmapSubTable::findGlyphId(uint32_t ch, uint32_t vs) const {
   if (vs != 0) {
-    LOG(FATAL) << "Vs is not supported";
+    if (!format14_ptr_)
+      return (uint32_t)-1;
+    return findFromFormat14(ch, vs);
   }
 
-  if (format12_ptr_) {
+  if (groups_) {
     return findFromFormat12(ch);
   }
 
   if (format4_ptr_) {
     return findFromFormat4(ch);
   }
-  LOG(FATAL) << "Not Found.";
+  return (uint32_t)-1;
 }
 
-uint32_t CmapSubTable::findFromFormat4(uint32_t ch) {
-  const size_t kSegCountOffset = 6;
-
-  uint32_t format = readU16(format4_ptr_, 0);
-  if (format != 4)
-    LOG(FATAL) << "Invalid format id";
-  uint32_t length = readU16(format4_ptr_, 2);
-  uint32_t seg_count = readU16(format4_ptr_, kSegCountOffset) >> 1;
-
-  for (size_t i = 0; i < seg_count; ++i) {
-    const size_t kEndCountOffset = 14;
-
-    const size_t endCountOffset = kEndCountOffset + 2 * i;
-    const size_t startCountOffset = kEndCountOffset + 2 +  2 * (seg_count + i);
-    uint32_t end = readU16(format4_ptr_, endCountOffset);
-    uint32_t start = readU16(format4_ptr_, startCountOffset);
-
-    const size_t deltaOffsetX = startCountOffset + 2 * seg_count;
-    if (ch < start || end < ch)
-      continue;
-
-    if (end < start)
-      LOG(FATAL) << "Invlaid segment range";
-
-    const size_t rangeOffset = startCountOffset + 2 * (2 * seg_count);
-    uint32_t rangeOffsetValue = readU16(format4_ptr_, rangeOffset);
-    if (rangeOffsetValue == 0) {
-      const size_t deltaOffset = startCountOffset + 2 * seg_count;
-      int16_t deltaOffsetValue =
-          static_cast<int16_t>(readU16(format4_ptr_, deltaOffset));
-      return ch + deltaOffsetValue;
-    } else {
-      LOG(ERROR) << "Not yet implemented.";
-    }
+uint32_t CmapSubTable::findFromFormat4(uint32_t ch) const {
+  if (ch > 0xFFFF)
+    return (uint32_t)-1;
+
+  // The first segment whose end code is not less than |ch|.
+  uint32_t lo = 0;
+  uint32_t hi = seg_count_;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (end_codes_[mid] < ch)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == seg_count_)
+    return (uint32_t)-1;
+  uint32_t start = start_codes_[lo];
+  if (ch < start)
+    return (uint32_t)-1;
+
+  uint16_t delta = id_deltas_[lo];
+  uint16_t range_offset = id_range_offsets_[lo];
+  uint16_t glyph_id = ch + delta;
+  if (range_offset != 0) {
+    // The offset is in bytes from the idRangeOffset entry itself into
+    // glyphIdArray.
+    size_t offset = (const uint8_t*)&id_range_offsets_[lo] - format4_ptr_ +
+        range_offset + (ch - start) * 2;
+    const UInt16* id = recordAt<UInt16>(format4_ptr_, format4_length_, offset);
+    if (!id || *id == 0)
+      return (uint32_t)-1;
+    glyph_id = *id + delta;
+  }
+  return glyph_id == 0 ? (uint32_t)-1 : glyph_id;
+}
 
+uint32_t CmapSubTable::findFromFormat12(uint32_t ch) const {
+  // The first group whose end is not less than |ch|.
+  uint32_t lo = 0;
+  uint32_t hi = num_groups_;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (groups_[mid].end_char_code < ch)
+      lo = mid + 1;
+    else
+      hi = mid;
   }
-  return (uint32_t)-1;
+  if (lo == num_groups_)
+    return (uint32_t)-1;
+  uint32_t start = groups_[lo].start_char_code;
+  if (ch < start)
+    return (uint32_t)-1;
+  return groups_[lo].start_glyph_id + (ch - start);
 }
 
-uint32_t CmapSubTable::findFromFormat12(uint32_t ch) {
-  uint32_t format = readU16(format12_ptr_, 0);
-  if (format != 12)
-    LOG(FATAL) << "Invalid format id";
-  uint32_t nGroups = readU32(format12_ptr_, 12);
-
-  const size_t kGroupOffset = 16;
-  for (size_t i = 0; i < nGroups; ++i) {
-    uint32_t start = readU32(format12_ptr_, kGroupOffset + i * 12);
-    uint32_t end = readU32(format12_ptr_, kGroupOffset + i * 12 + 4);
-    uint32_t glyphId = readU32(format12_ptr_, kGroupOffset + i * 12 + 8);
-    if (ch < start || end < ch)
-      continue;
-    return glyphId + (ch - start);
+uint32_t CmapSubTable::findFromFormat14(uint32_t ch, uint32_t vs) const {
+  uint32_t lo = 0;
+  uint32_t hi = num_var_selectors_;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (var_selectors_[mid].var_selector < vs)
+      lo = mid + 1;
+    else
+      hi = mid;
   }
-  return (uint32_t)-1;
+  if (lo == num_var_selectors_ || var_selectors_[lo].var_selector != vs)
+    return (uint32_t)-1;
+  const VariationSelector& record = var_selectors_[lo];
+
+  // The default UVS lists the sequences showing the glyph of |ch| itself.
+  uint32_t count = 0;
+  const UnicodeRange* ranges = uvsRecords<UnicodeRange>(
+      format14_ptr_, format14_length_, record.default_uvs_offset, &count);
+  if (ranges && findRecord(ranges, count, ch))
+    return findGlyphId(ch, 0);
+
+  const UvsMapping* mappings = uvsRecords<UvsMapping>(
+      format14_ptr_, format14_length_, record.non_default_uvs_offset, &count);
+  const UvsMapping* mapping = mappings ? findRecord(mappings, count, ch)
+                                       : nullptr;
+  return mapping ? mapping->glyph_id : (uint32_t)-1;
 }
@@ -3,18 +3,83 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "big_endian.h"
+
+// Whether |ch| is a variation selector, which selects a variant glyph of the
+// character before it.
+inline bool isVariationSelector(uint32_t ch) {
+  return (ch >= 0xFE00 && ch <= 0xFE0F) || (ch >= 0xE0100 && ch <= 0xE01EF) ||
+      (ch >= 0x180B && ch <= 0x180D);
+}
+
 class CmapSubTable {
  public:
   CmapSubTable(const void* ptr, size_t length);
 
-  uint32_t findGlyphId(uint32_t ch, uint32_t vs);
+  // Returns the glyph of |ch| or, if |vs| is not 0, of the variation
+  // sequence of |ch| and |vs|. Returns (uint32_t)-1 if it is not mapped.
+  uint32_t findGlyphId(uint32_t ch, uint32_t vs) const;
 
  private:
-  uint32_t findFromFormat4(uint32_t ch);
-  uint32_t findFromFormat12(uint32_t ch);
+  struct Format4Header {
+    UInt16 format;
+    UInt16 length;
+    UInt16 language;
+    UInt16 seg_count_x2;
+    UInt16 search_range;
+    UInt16 entry_selector;
+    UInt16 range_shift;
+  };
+
+  struct Format12Header {
+    UInt16 format;
+    UInt16 reserved;
+    UInt32 length;
+    UInt32 language;
+    UInt32 num_groups;
+  };
+
+  struct SequentialMapGroup {
+    UInt32 start_char_code;
+    UInt32 end_char_code;
+    UInt32 start_glyph_id;
+  };
+
+  struct Format14Header {
+    UInt16 format;
+    UInt32 length;
+    UInt32 num_var_selector_records;
+  };
+
+  struct VariationSelector {
+    UInt24 var_selector;
+    Offset32 default_uvs_offset;
+    Offset32 non_default_uvs_offset;
+  };
+
+  void initFormat4(const uint8_t* ptr, size_t length);
+  void initFormat12(const uint8_t* ptr, size_t length);
+  void initFormat14(const uint8_t* ptr, size_t length);
+
+  uint32_t findFromFormat4(uint32_t ch) const;
+  uint32_t findFromFormat12(uint32_t ch) const;
+  uint32_t findFromFormat14(uint32_t ch, uint32_t vs) const;
+
+  // The subtables run to the end of the cmap table, since the format 4
+  // length field overflows in large subtables.
+  const uint8_t* format4_ptr_;
+  size_t format4_length_;
+  uint32_t seg_count_;
+  const UInt16* end_codes_;
+  const UInt16* start_codes_;
+  const UInt16* id_deltas_;
+  const UInt16* id_range_offsets_;
 
-  uint8_t* format4_ptr_;
-  uint8_t* format12_ptr_;
-  uint8_t* format14_ptr_;
+  const SequentialMapGroup* groups_;
+  uint32_t num_groups_;
 
+  const uint8_t* format14_ptr_;
+  size_t format14_length_;
+  const VariationSelector* var_selectors_;
+  uint32_t num_var_selectors_;
 };
@@ -0,0 +1,88 @@
+#include "cmap_index.h"
+
+#include "utf8.h"
+
+CmapIndex::CmapIndex(const CmapSubTable& cmap) : cmap_(cmap) {
+  for (uint32_t i = 0; i < kNumPages; ++i)
+    pages_[i].store(nullptr, std::memory_order_relaxed);
+  for (uint32_t i = 0; i < kPageSize; ++i)
+    empty_page_[i] = kUnmapped;
+}
+
+CmapIndex::~CmapIndex() {
+  for (uint32_t i = 0; i < kNumPages; ++i) {
+    const uint16_t* page = pages_[i].load(std::memory_order_relaxed);
+    if (page != empty_page_)
+      delete[] page;
+  }
+}
+
+uint32_t CmapIndex::findGlyphId(uint32_t ch, uint32_t vs) const {
+  uint32_t glyph_id = cmap_.findGlyphId(ch, vs);
+  return glyph_id != (uint32_t)-1 ? glyph_id : findGlyphId(ch);
+}
+
+size_t CmapIndex::findGlyphIds(const uint32_t* text, size_t length,
+                               uint32_t* glyph_ids) const {
+  // Text mostly stays in a page, so the last page is kept at hand.
+  uint32_t last = kNumPages;
+  const uint16_t* page = nullptr;
+  size_t n = 0;
+  for (size_t i = 0; i < length; ++i) {
+    uint32_t ch = text[i];
+    if (i + 1 < length && isVariationSelector(text[i + 1])) {
+      glyph_ids[n++] = findGlyphId(ch, text[i + 1]);
+      ++i;
+      continue;
+    }
+    if (isVariationSelector(ch))
+      continue;  // Not after a character.
+    if (ch >= kNumPages * kPageSize) {
+      glyph_ids[n++] = (uint32_t)-1;
+      continue;
+    }
+    if ((ch >> 8) != last) {
+      last = ch >> 8;
+      page = pages_[last].load(std::memory_order_acquire);
+      if (!page)
+        page = buildPage(last);
+    }
+    uint16_t glyph_id = page[ch & (kPageSize - 1)];
+    glyph_ids[n++] = glyph_id == kUnmapped ? (uint32_t)-1 : glyph_id;
+  }
+  return n;
+}
+
+bool CmapIndex::findGlyphIdsFromUtf8(const char* text, size_t length,
+                                     std::vector<uint32_t>* glyph_ids) const {
+  glyph_ids->clear();
+  bool valid = decodeUtf8(text, length, glyph_ids);
+  glyph_ids->resize(findGlyphIds(glyph_ids->data(), glyph_ids->size(),
+                                 glyph_ids->data()));
+  return valid;
+}
+
+const uint16_t* CmapIndex::buildPage(uint32_t page) const {
+  uint16_t* built = new uint16_t[kPageSize];
+  bool empty = true;
+  for (uint32_t i = 0; i < kPageSize; ++i) {
+    uint32_t glyph_id = cmap_.findGlyphId(page * kPageSize + i, 0);
+    built[i] = glyph_id < kUnmapped ? glyph_id : kUnmapped;
+    empty &= built[i] == kUnmapped;
+  }
+
+  const uint16_t* result = built;
+  if (empty) {
+    delete[] built;
+    result = empty_page_;
+  }
+  // Another thread may have built the same page.
+  const uint16_t* expected = nullptr;
+  if (!pages_[page].compare_exchange_strong(expected, result,
+                                            std::memory_order_acq_rel)) {
+    if (result != empty_page_)
+      delete[] result;
+    return expected;
+  }
+  return result;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <vector>
+
+#include "cmap.h"
+
+// Maps code points to glyph ids through a two level table of 256 code point
+// pages. A page is filled from the cmap subtable the first time one of its
+// code points is looked up, so a lookup is a couple of loads after that.
+// Lookups can be made from any thread.
+class CmapIndex {
+ public:
+  explicit CmapIndex(const CmapSubTable& cmap);
+  ~CmapIndex();
+
+  // Returns (uint32_t)-1 if |ch| is not mapped.
+  uint32_t findGlyphId(uint32_t ch) const {
+    if (ch >= kNumPages * kPageSize)
+      return (uint32_t)-1;
+    const uint16_t* page = pages_[ch >> 8].load(std::memory_order_acquire);
+    if (!page)
+      page = buildPage(ch >> 8);
+    uint16_t glyph_id = page[ch & (kPageSize - 1)];
+    return glyph_id == kUnmapped ? (uint32_t)-1 : glyph_id;
+  }
+
+  // Returns the glyph of the variation sequence of |ch| and |vs|, or of |ch|
+  // alone if the font does not have the sequence.
+  uint32_t findGlyphId(uint32_t ch, uint32_t vs) const;
+
+  // Maps |length| code points of |text| into |glyph_ids|, which can be
+  // |text| itself. A variation selector picks the glyph for the character
+  // before it and has no glyph of its own. Returns the number of glyph ids.
+  size_t findGlyphIds(const uint32_t* text, size_t length,
+                      uint32_t* glyph_ids) const;
+
+  // Decodes |length| bytes of UTF-8 |text| (see decodeUtf8) and maps it into
+  // |glyph_ids| like findGlyphIds. Returns false if the text is malformed.
+  bool findGlyphIdsFromUtf8(const char* text, size_t length,
+                            std::vector<uint32_t>* glyph_ids) const;
+
+ private:
+  static const uint32_t kPageSize = 256;
+  static const uint32_t kNumPages = 0x110000 / kPageSize;
+  static const uint16_t kUnmapped = 0xFFFF;
+
+  const uint16_t* buildPage(uint32_t page) const;
+
+  const CmapSubTable& cmap_;
+
+  // Filled lazily. The pages without any mapping share |empty_page_|.
+  mutable std::atomic<const uint16_t*> pages_[kNumPages];
+  uint16_t empty_page_[kPageSize];
+};
@@ -0,0 +1,81 @@
+#include "coverage_accumulator.h"
+
+#include <math.h>
+#include <algorithm>
+
+#include "coverage_kernels.h"
+
+CoverageAccumulator::CoverageAccumulator(int width, int height)
+    : width_(width), height_(height), cells_(width * height + 2, 0.0f) {}
+
+void CoverageAccumulator::addLine(float x0, float y0, float x1, float y1) {
+  if (y0 == y1)
+    return;
+
+  // Always walk upward. The direction gives the sign of the area.
+  float dir = 1.0f;
+  if (y0 > y1) {
+    std::swap(x0, x1);
+    std::swap(y0, y1);
+    dir = -1.0f;
+  }
+  float dxdy = (x1 - x0) / (y1 - y0);
+  float x = x0;
+  if (y0 < 0.0f) {
+    x -= y0 * dxdy;
+    y0 = 0.0f;
+  }
+
+  int row_end = std::min(height_, (int)ceilf(y1));
+  for (int y = (int)y0; y < row_end; ++y) {
+    float* row = &cells_[y * width_];
+    float dy = std::min((float)(y + 1), y1) - std::max((float)y, y0);
+    float x_next = x + dxdy * dy;
+    float d = dy * dir;
+
+    // Clamped for the rounding errors around the bitmap edges.
+    const float w = width_;
+    float left = std::min(std::max(std::min(x, x_next), 0.0f), w);
+    float right = std::min(std::max(std::max(x, x_next), left), w);
+    float left_floor = floorf(left);
+    int left_i = (int)left_floor;
+    float right_ceil = ceilf(right);
+    int right_i = (int)right_ceil;
+
+    if (right_i <= left_i + 1) {
+      // Within a cell. The cover beyond the middle point goes to the next.
+      float xm = 0.5f * (left + right) - left_floor;
+      row[left_i] += d - d * xm;
+      row[left_i + 1] += d * xm;
+    } else {
+      // Spans several cells. The area of each cell is the trapezoid under
+      // the segment.
+      float s = 1.0f / (right - left);
+      float left_frac = left - left_floor;
+      float a0 = 0.5f * s * (1.0f - left_frac) * (1.0f - left_frac);
+      float right_frac = right - right_ceil + 1.0f;
+      float am = 0.5f * s * right_frac * right_frac;
+
+      row[left_i] += d * a0;
+      if (right_i == left_i + 2) {
+        row[left_i + 1] += d * (1.0f - a0 - am);
+      } else {
+        float a1 = s * (1.5f - left_frac);
+        row[left_i + 1] += d * (a1 - a0);
+        for (int xi = left_i + 2; xi < right_i - 1; ++xi)
+          row[xi] += d * s;
+        float a2 = a1 + (right_i - left_i - 3) * s;
+        row[right_i - 1] += d * (1.0f - a2 - am);
+      }
+      row[right_i] += d * am;
+    }
+    x = x_next;
+  }
+}
+
+void CoverageAccumulator::resolve(std::vector<uint8_t>* out) const {
+  const size_t n = width_ * height_;
+  out->resize(n);
+  if (n != 0)
+    coverageKernel().accumulate(&cells_[0], &(*out)[0], n);
+}
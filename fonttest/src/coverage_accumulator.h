@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// Accumulates the exact area coverage of an outline for anti-aliased
+// rendering.
+//
+// Curves are flattened into lines beforehand. Each line adds the signed area
+// it covers in a cell and carries the rest of its cover to the next cell, so
+// the prefix sum along a row gives the coverage of each pixel. Coordinates are in pixels, origin at the bottom
+// left corner of the bitmap.
+class CoverageAccumulator {
+ public:
+  CoverageAccumulator(int width, int height);
+
+  void addLine(float x0, float y0, float x1, float y1);
+
+  // Writes 8-bit alpha values. The row 0 is the bottom row.
+  void resolve(std::vector<uint8_t>* out) const;
+
+ private:
+  int width_;
+  int height_;
+  // width * height cells, plus the cover carried out of the last row.
+  std::vector<float> cells_;
+};
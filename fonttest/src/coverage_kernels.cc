@@ -0,0 +1,101 @@
+#include "coverage_kernels.h"
+
+#include <math.h>
+
+#include "cpu_features.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+inline uint8_t toAlpha(float acc) {
+  float coverage = fabsf(acc);
+  if (coverage > 1.0f)
+    coverage = 1.0f;
+  return (uint8_t)(coverage * 255.0f + 0.5f);
+}
+
+}  // namespace
+
+void accumulateScalar(const float* cells, uint8_t* out, size_t n) {
+  accumulateScalarFrom(cells, out, n, 0.0f);
+}
+
+void accumulateScalarFrom(const float* cells, uint8_t* out, size_t n,
+                          float carry) {
+  for (size_t i = 0; i < n; i += 4) {
+    float c0 = cells[i];
+    float c1 = i + 1 < n ? cells[i + 1] : 0.0f;
+    float c2 = i + 2 < n ? cells[i + 2] : 0.0f;
+    float c3 = i + 3 < n ? cells[i + 3] : 0.0f;
+
+    // The same order as the vector kernels: shift by one, then by two.
+    float s1 = c1 + c0;
+    float s2 = c2 + c1;
+    float s3 = c3 + c2;
+    float p[4] = { c0 + carry, s1 + carry, (s2 + c0) + carry,
+                   (s3 + s1) + carry };
+    for (size_t j = 0; j < 4 && i + j < n; ++j)
+      out[i + j] = toAlpha(p[j]);
+    carry = p[3];
+  }
+}
+
+#if defined(__SSE2__)
+
+void accumulateSse2(const float* cells, uint8_t* out, size_t n) {
+  const __m128 sign = _mm_set1_ps(-0.0f);
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 scale = _mm_set1_ps(255.0f);
+  const __m128 half = _mm_set1_ps(0.5f);
+  __m128 carry = _mm_setzero_ps();
+
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 x = _mm_loadu_ps(cells + i);
+    x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)));
+    x = _mm_add_ps(x, _mm_shuffle_ps(_mm_setzero_ps(), x, 0x40));
+    x = _mm_add_ps(x, carry);
+
+    __m128 y = _mm_min_ps(_mm_andnot_ps(sign, x), one);
+    y = _mm_add_ps(_mm_mul_ps(y, scale), half);
+    __m128i z = _mm_cvttps_epi32(y);
+    z = _mm_packs_epi32(z, z);
+    z = _mm_packus_epi16(z, z);
+    int32_t bytes = _mm_cvtsi128_si32(z);
+    __builtin_memcpy(out + i, &bytes, 4);
+
+    carry = _mm_shuffle_ps(x, x, 0xFF);
+  }
+
+  accumulateScalarFrom(cells + i, out + i, n - i, _mm_cvtss_f32(carry));
+}
+
+#else
+
+void accumulateSse2(const float* cells, uint8_t* out, size_t n) {
+  accumulateScalar(cells, out, n);
+}
+
+#endif
+
+const CoverageKernel& coverageKernel() {
+  static const CoverageKernel kernel = supportedCoverageKernels().back();
+  return kernel;
+}
+
+std::vector<CoverageKernel> supportedCoverageKernels() {
+  std::vector<CoverageKernel> kernels;
+  kernels.push_back({ "scalar", accumulateScalar });
+#if defined(__SSE2__)
+  if (cpuFeatures().sse2)
+    kernels.push_back({ "sse2", accumulateSse2 });
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+  if (cpuFeatures().avx2)
+    kernels.push_back({ "avx2", accumulateAvx2 });
+#endif
+  return kernels;
+}
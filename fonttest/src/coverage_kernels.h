@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Resolves a coverage accumulation buffer into 8-bit alpha: the running sum
+// of |cells|, its absolute value clamped to 1.0, scaled to 0 - 255.
+//
+// All the implementations sum the cells in blocks of four with the same
+// association order, so they produce identical bytes on every CPU.
+typedef void (*AccumulateKernel)(const float* cells, uint8_t* out, size_t n);
+
+struct CoverageKernel {
+  const char* name;
+  AccumulateKernel accumulate;
+};
+
+void accumulateScalar(const float* cells, uint8_t* out, size_t n);
+void accumulateSse2(const float* cells, uint8_t* out, size_t n);
+void accumulateAvx2(const float* cells, uint8_t* out, size_t n);
+
+// The scalar kernel continuing from the running sum |carry|. The vector
+// kernels finish the cells left over from their blocks with it.
+void accumulateScalarFrom(const float* cells, uint8_t* out, size_t n,
+                          float carry);
+
+// The fastest kernel the CPU supports, selected with cpuid once.
+const CoverageKernel& coverageKernel();
+
+// All the kernels the CPU supports.
+std::vector<CoverageKernel> supportedCoverageKernels();
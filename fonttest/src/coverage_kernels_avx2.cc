@@ -0,0 +1,47 @@
+// Built with -mavx2. Only called when cpuid reports AVX2, so this file must
+// not define anything shared with the other translation units.
+#include "coverage_kernels.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+
+void accumulateAvx2(const float* cells, uint8_t* out, size_t n) {
+  const __m256 sign = _mm256_set1_ps(-0.0f);
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 scale = _mm256_set1_ps(255.0f);
+  const __m256 half = _mm256_set1_ps(0.5f);
+  __m128 carry = _mm_setzero_ps();
+
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    // The prefix sums of each four cells, as the SSE2 kernel does.
+    __m256 x = _mm256_loadu_ps(cells + i);
+    x = _mm256_add_ps(
+        x, _mm256_castsi256_ps(_mm256_slli_si256(_mm256_castps_si256(x), 4)));
+    x = _mm256_add_ps(x, _mm256_shuffle_ps(_mm256_setzero_ps(), x, 0x40));
+
+    // Carry into the lower four, then from them into the upper four.
+    __m128 lo = _mm_add_ps(_mm256_castps256_ps128(x), carry);
+    carry = _mm_shuffle_ps(lo, lo, 0xFF);
+    __m128 hi = _mm_add_ps(_mm256_extractf128_ps(x, 1), carry);
+    carry = _mm_shuffle_ps(hi, hi, 0xFF);
+    x = _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1);
+
+    __m256 y = _mm256_min_ps(_mm256_andnot_ps(sign, x), one);
+    y = _mm256_add_ps(_mm256_mul_ps(y, scale), half);
+    __m256i z = _mm256_cvttps_epi32(y);
+    __m128i z16 = _mm_packs_epi32(_mm256_castsi256_si128(z),
+                                  _mm256_extracti128_si256(z, 1));
+    _mm_storel_epi64((__m128i*)(out + i), _mm_packus_epi16(z16, z16));
+  }
+
+  accumulateScalarFrom(cells + i, out + i, n - i, _mm_cvtss_f32(carry));
+}
+
+#else
+
+void accumulateAvx2(const float* cells, uint8_t* out, size_t n) {
+  accumulateSse2(cells, out, n);
+}
+
+#endif
@@ -0,0 +1,51 @@
+#include "cpu_features.h"
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define HAS_CPUID 1
+#endif
+
+namespace {
+
+#if HAS_CPUID
+uint64_t xgetbv(uint32_t index) {
+  uint32_t eax, edx;
+  // xgetbv, spelled out for old assemblers.
+  __asm__ volatile(".byte 0x0f, 0x01, 0xd0"
+                   : "=a"(eax), "=d"(edx) : "c"(index));
+  return (uint64_t)edx << 32 | eax;
+}
+#endif
+
+CpuFeatures detect() {
+  CpuFeatures features = {};
+#if HAS_CPUID
+  uint32_t eax, ebx, ecx, edx;
+  uint32_t max_leaf = __get_cpuid_max(0, nullptr);
+  if (max_leaf < 1)
+    return features;
+
+  __cpuid(1, eax, ebx, ecx, edx);
+  features.sse2 = (edx & (1u << 26)) != 0;
+  features.ssse3 = (ecx & (1u << 9)) != 0;
+
+  // AVX registers must be enabled by the OS as well.
+  bool osxsave = (ecx & (1u << 27)) != 0;
+  bool avx = (ecx & (1u << 28)) != 0;
+  bool ymm_enabled = osxsave && (xgetbv(0) & 0x6) == 0x6;
+  if (avx && ymm_enabled && max_leaf >= 7) {
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    features.avx2 = (ebx & (1u << 5)) != 0;
+  }
+#endif
+  return features;
+}
+
+}  // namespace
+
+const CpuFeatures& cpuFeatures() {
+  static const CpuFeatures features = detect();
+  return features;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+// The instruction set extensions available on the running CPU.
+struct CpuFeatures {
+  bool sse2;
+  bool ssse3;
+  bool avx2;
+};
+
+// Detected with cpuid once, on the first call.
+const CpuFeatures& cpuFeatures();
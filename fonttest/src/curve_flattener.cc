@@ -0,0 +1,85 @@
+#include "curve_flattener.h"
+
+#include <stdint.h>
+
+namespace {
+
+const int kMaxSegments = 256;
+
+int64_t isqrt(int64_t v) {
+  int64_t r = 0;
+  for (int64_t bit = (int64_t)1 << 62; bit != 0; bit >>= 2) {
+    if (v >= r + bit) {
+      v -= r + bit;
+      r = (r >> 1) + bit;
+    } else {
+      r >>= 1;
+    }
+  }
+  return r;
+}
+
+// The point at t = i / n, rounded to the nearest.
+F26Dot6 evalQuad(F26Dot6 a, F26Dot6 b, F26Dot6 c, int64_t i, int64_t n) {
+  int64_t v = a * (n - i) * (n - i) + 2 * b * i * (n - i) + c * i * i;
+  return floorDiv(v + n * n / 2, n * n);
+}
+
+}  // namespace
+
+void CurveFlattener::moveTo(F26Dot6 x, F26Dot6 y) {
+  out_->addPoint(x, y, true);
+  x_ = x;
+  y_ = y;
+}
+
+void CurveFlattener::lineTo(F26Dot6 x, F26Dot6 y) {
+  out_->addPoint(x, y, true);
+  x_ = x;
+  y_ = y;
+}
+
+void CurveFlattener::quadTo(F26Dot6 cx, F26Dot6 cy, F26Dot6 x, F26Dot6 y) {
+  int n = quadSegmentCount(x_, y_, cx, cy, x, y, tolerance_);
+  for (int i = 1; i < n; ++i) {
+    out_->addPoint(evalQuad(x_, cx, x, i, n), evalQuad(y_, cy, y, i, n),
+                   true);
+  }
+  lineTo(x, y);
+}
+
+void CurveFlattener::close() {
+  // The polyline closes itself, so the point back at the start goes away.
+  size_t start = out_->contour_ends.empty() ? 0
+      : out_->contour_ends.back() + 1;
+  size_t last = out_->numPoints() - 1;
+  if (last > start && out_->x[last] == out_->x[start] &&
+      out_->y[last] == out_->y[start])
+    out_->removeLastPoint();
+  out_->closeContour();
+}
+
+int quadSegmentCount(F26Dot6 x0, F26Dot6 y0, F26Dot6 x1, F26Dot6 y1,
+                     F26Dot6 x2, F26Dot6 y2, F26Dot6 tolerance) {
+  int64_t dx = x0 - 2 * (int64_t)x1 + x2;
+  int64_t dy = y0 - 2 * (int64_t)y1 + y2;
+  int64_t dd_sq = dx * dx + dy * dy;
+
+  // The smallest n with 4 * tolerance * n * n >= |dd|, in integers.
+  int64_t n = isqrt(isqrt(dd_sq) / (4 * tolerance));
+  if (n < 1)
+    n = 1;
+  while (n < kMaxSegments) {
+    int64_t bound = 4 * tolerance * n * n;
+    if (bound * bound >= dd_sq)
+      break;
+    ++n;
+  }
+  return n;
+}
+
+void flattenOutline(const Outline& outline, F26Dot6 tolerance, Outline* out) {
+  out->clear();
+  CurveFlattener flattener(tolerance, out);
+  decomposeOutline(outline, &flattener);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "fixed.h"
+#include "outline.h"
+
+// The largest distance between a curve and its lines, in 26.6 pixels. Since
+// the outline is already scaled to the pixel grid, the number of lines for a
+// curve grows with the square root of the ppem.
+const F26Dot6 kFlatteningTolerance = 8;
+
+// The number of lines which keeps the curve p0 - p1 - p2 within |tolerance|.
+// The uniform n lines are at most |p0 - 2 * p1 + p2| / (4 * n * n) away from
+// the curve, so n = ceil(sqrt(|p0 - 2 * p1 + p2| / (4 * tolerance))).
+int quadSegmentCount(F26Dot6 x0, F26Dot6 y0, F26Dot6 x1, F26Dot6 y1,
+                     F26Dot6 x2, F26Dot6 y2, F26Dot6 tolerance);
+
+// A path sink appending the path to |out| with the curves split into lines.
+// The path is in 26.6 pixels.
+class CurveFlattener {
+ public:
+  CurveFlattener(F26Dot6 tolerance, Outline* out)
+      : tolerance_(tolerance), out_(out), x_(0), y_(0) {}
+
+  void moveTo(F26Dot6 x, F26Dot6 y);
+  void lineTo(F26Dot6 x, F26Dot6 y);
+  void quadTo(F26Dot6 cx, F26Dot6 cy, F26Dot6 x, F26Dot6 y);
+  void close();
+
+ private:
+  const F26Dot6 tolerance_;
+  Outline* out_;
+  F26Dot6 x_;
+  F26Dot6 y_;
+};
+
+// Splits all the curves of the 26.6 |outline| into lines, once per glyph.
+// Every point of |out| is on curve and each contour is a closed polyline.
+// Both the scan converter and the coverage accumulator consume the result.
+void flattenOutline(const Outline& outline, F26Dot6 tolerance, Outline* out);
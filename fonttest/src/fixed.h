@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdint.h>
+
+// 26.6 fixed point. 64 is one pixel.
+typedef int32_t F26Dot6;
+
+const F26Dot6 kF26Dot6One = 64;
+const F26Dot6 kF26Dot6Half = 32;
+
+// Division rounding toward negative infinity. |d| must be positive.
+inline int64_t floorDiv(int64_t n, int64_t d) {
+  int64_t q = n / d;
+  return (n % d < 0) ? q - 1 : q;
+}
+
+inline F26Dot6 pixelFloor(F26Dot6 v) { return v & -kF26Dot6One; }
+inline F26Dot6 pixelCeil(F26Dot6 v) {
+  return (v + kF26Dot6One - 1) & -kF26Dot6One;
+}
+inline F26Dot6 pixelRound(F26Dot6 v) {
+  return (v + kF26Dot6Half) & -kF26Dot6One;
+}
+
+// One in 2.14 fixed point, the unit vectors of the hinting graphics state.
+const int32_t kF2Dot14One = 0x4000;
+
+// 16.16 fixed point, the scale from font units to 26.6 pixels.
+typedef int32_t F16Dot16;
+
+// The helpers below round the same way as FreeType, so that the hinted
+// outlines match it bit for bit.
+
+// a * b / c, rounded half away from zero. Saturates if |c| is 0.
+inline int32_t mulDiv(int64_t a, int64_t b, int64_t c) {
+  bool negative = ((a < 0) != (b < 0)) != (c < 0);
+  uint64_t ua = a < 0 ? -a : a;
+  uint64_t ub = b < 0 ? -b : b;
+  uint64_t uc = c < 0 ? -c : c;
+  uint64_t d = uc > 0 ? (ua * ub + (uc >> 1)) / uc : 0x7FFFFFFF;
+  return negative ? -(int64_t)d : (int64_t)d;
+}
+
+// a * b / c, truncated toward zero. Saturates if |c| is 0.
+inline int32_t mulDivNoRound(int64_t a, int64_t b, int64_t c) {
+  bool negative = ((a < 0) != (b < 0)) != (c < 0);
+  uint64_t ua = a < 0 ? -a : a;
+  uint64_t ub = b < 0 ? -b : b;
+  uint64_t uc = c < 0 ? -c : c;
+  uint64_t d = uc > 0 ? ua * ub / uc : 0x7FFFFFFF;
+  return negative ? -(int64_t)d : (int64_t)d;
+}
+
+// a * b for a 16.16 |b|, rounded half away from zero.
+inline int32_t mulFix(int32_t a, F16Dot16 b) {
+  int64_t ab = (int64_t)a * b;
+  return (int32_t)((ab + 0x8000 - (ab < 0)) >> 16);
+}
+
+// a / b in 16.16, rounded half away from zero. Saturates if b is 0.
+inline F16Dot16 divFix(int32_t a, int32_t b) {
+  return mulDiv(a, 0x10000, b);
+}
+
+// The 16.16 scale from font units into 26.6 pixels at the whole |ppem| the
+// glyphs are hinted at. The unhinted glyphs use it too, so that both come
+// out at the same size.
+inline F16Dot16 pixelScale(int ppem, int unit_per_em) {
+  return divFix(ppem * kF26Dot6One, unit_per_em);
+}
+
+// a * b for a 2.14 |b|, rounded half away from zero.
+inline int32_t mulFix14(int32_t a, int32_t b) {
+  int64_t ab = (int64_t)a * b;
+  ab += 0x2000 + (ab >> 63);
+  return (int32_t)(ab >> 14);
+}
+
+// The dot product of (ax, ay) and the 2.14 vector (bx, by), rounded half
+// away from zero.
+inline int32_t dotFix14(int32_t ax, int32_t ay, int32_t bx, int32_t by) {
+  int64_t dot = (int64_t)ax * bx + (int64_t)ay * by;
+  dot += 0x2000 + (dot >> 63);
+  return (int32_t)(dot >> 14);
+}
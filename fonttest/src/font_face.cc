@@ -0,0 +1,77 @@
+#include "font_face.h"
+
+#include "cmap.h"
+#include "cmap_index.h"
+#include "cvt.h"
+#include "fpgm.h"
+#include "glyf.h"
+#include "head.h"
+#include "hhea.h"
+#include "hmtx.h"
+#include "loca.h"
+#include "maxp.h"
+#include "os2.h"
+#include "prep.h"
+#include "utils.h"
+
+#include <glog/logging.h>
+
+FontFace::FontFace(const std::string& fname, int index)
+    : truetype_(fname, index) {
+  size_t length;
+  const void* ptr;
+
+  ptr = getRequiredTable(makeTag('c', 'm', 'a', 'p'), &length);
+  cmap_.reset(new CmapSubTable(ptr, length));
+  cmap_index_.reset(new CmapIndex(*cmap_));
+
+  ptr = getRequiredTable(makeTag('m', 'a', 'x', 'p'), &length);
+  maxp_.reset(new MaxpSubTable(ptr, length));
+
+  ptr = getRequiredTable(makeTag('h', 'e', 'a', 'd'), &length);
+  head_.reset(new HeadSubTable(ptr, length));
+
+  ptr = getRequiredTable(makeTag('l', 'o', 'c', 'a'), &length);
+  loca_.reset(new LocaSubTable(ptr, length, maxp_->num_glyphs()));
+
+  ptr = getRequiredTable(makeTag('g', 'l', 'y', 'f'), &length);
+  glyf_.reset(new GlyfSubTable(ptr, length));
+
+  ptr = getRequiredTable(makeTag('h', 'h', 'e', 'a'), &length);
+  hhea_.reset(new HheaSubTable(ptr, length));
+
+  ptr = getRequiredTable(makeTag('h', 'm', 't', 'x'), &length);
+  hmtx_.reset(new HmtxSubTable(ptr, length, hhea_->num_h_metrics(),
+                               maxp_->num_glyphs()));
+
+  ptr = truetype_.getTable(makeTag('f', 'p', 'g', 'm'), &length);
+  fpgm_.reset(new FpgmSubTable(ptr, length));
+
+  ptr = truetype_.getTable(makeTag('p', 'r', 'e', 'p'), &length);
+  prep_.reset(new PrepSubTable(ptr, length));
+
+  ptr = truetype_.getTable(makeTag('c', 'v', 't', ' '), &length);
+  cvt_.reset(new CvtSubTable(ptr, length));
+
+  ptr = truetype_.getTable(makeTag('O', 'S', '/', '2'), &length);
+  os2_.reset(new Os2SubTable(ptr, length));
+}
+
+FontFace::~FontFace() {}
+
+uint32_t FontFace::num_glyphs() const {
+  return maxp_->num_glyphs();
+}
+
+uint32_t FontFace::unit_per_em() const {
+  return head_->unit_per_em();
+}
+
+const void* FontFace::getRequiredTable(uint32_t tag, size_t* length) const {
+  const void* ptr = truetype_.getTable(tag, length);
+  if (!ptr) {
+    LOG(FATAL) << "Missing table: " << (char)(tag >> 24) << (char)(tag >> 16)
+               << (char)(tag >> 8) << (char)tag;
+  }
+  return ptr;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "truetype.h"
+
+class CmapIndex;
+
+// A font parsed once. The table directory is validated and indexed when the
+// face is created, and each table is parsed into a view living as long as the
+// face. Nothing changes afterwards, so a face can be shared between threads,
+// each with its own Rasterizer and GlyphCache.
+class FontFace {
+ public:
+  FontFace(const std::string& fname, int index);
+  ~FontFace();
+
+  FontFace(const FontFace&) = delete;
+  FontFace& operator=(const FontFace&) = delete;
+
+  const TrueType& truetype() const { return truetype_; }
+
+  const CmapSubTable& cmap() const { return *cmap_; }
+  const CmapIndex& cmap_index() const { return *cmap_index_; }
+  const MaxpSubTable& maxp() const { return *maxp_; }
+  const HeadSubTable& head() const { return *head_; }
+  const LocaSubTable& loca() const { return *loca_; }
+  const GlyfSubTable& glyf() const { return *glyf_; }
+  const HheaSubTable& hhea() const { return *hhea_; }
+  const HmtxSubTable& hmtx() const { return *hmtx_; }
+
+  // Empty if the font does not have the table.
+  const FpgmSubTable& fpgm() const { return *fpgm_; }
+  const PrepSubTable& prep() const { return *prep_; }
+  const CvtSubTable& cvt() const { return *cvt_; }
+  const Os2SubTable& os2() const { return *os2_; }
+
+  uint32_t num_glyphs() const;
+  uint32_t unit_per_em() const;
+
+ private:
+  // Aborts if the font does not have the table.
+  const void* getRequiredTable(uint32_t tag, size_t* length) const;
+
+  TrueType truetype_;
+
+  std::unique_ptr<CmapSubTable> cmap_;
+  std::unique_ptr<CmapIndex> cmap_index_;
+  std::unique_ptr<MaxpSubTable> maxp_;
+  std::unique_ptr<HeadSubTable> head_;
+  std::unique_ptr<LocaSubTable> loca_;
+  std::unique_ptr<GlyfSubTable> glyf_;
+  std::unique_ptr<HheaSubTable> hhea_;
+  std::unique_ptr<HmtxSubTable> hmtx_;
+  std::unique_ptr<FpgmSubTable> fpgm_;
+  std::unique_ptr<PrepSubTable> prep_;
+  std::unique_ptr<CvtSubTable> cvt_;
+  std::unique_ptr<Os2SubTable> os2_;
+};
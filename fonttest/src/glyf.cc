@@ -1,164 +1,250 @@
 #include "glyf.h"
 
-#include "utils.h"
+#include "big_endian.h"
+#include "glyph_cache.h"
 #include "loca.h"
 #include <glog/logging.h>
 
 std::unique_ptr<GlyfData> GlyfSubTable::getGlyfData(uint32_t offset, LocaSubTable* loca) const {
-  const uint8_t* glyph = ptr_ + offset;
-  int16_t num_of_contours = readS16(glyph, 0);
-  if (num_of_contours < 0) 
+  const GlyfHeader* header = recordAt<GlyfHeader>(ptr_, length_, offset);
+  if (!header)
+    LOG(FATAL) << "Invalid glyph offset.";
+  if (header->number_of_contours < 0)
     return std::unique_ptr<GlyfData>(getCompositeGlyfData(offset, loca).release());
   else
     return std::unique_ptr<GlyfData>(getSimpleGlyfData(offset).release());
 }
 
+bool GlyfSubTable::getGlyfHeader(uint32_t offset, GlyfData* header) const {
+  const GlyfHeader* record = recordAt<GlyfHeader>(ptr_, length_, offset);
+  if (!record)
+    return false;
+  header->num_of_contours = record->number_of_contours;
+  header->x_min = record->x_min;
+  header->y_min = record->y_min;
+  header->x_max = record->x_max;
+  header->y_max = record->y_max;
+  return true;
+}
+
 std::unique_ptr<SimpleGlyphData> GlyfSubTable::getCompositeGlyfData(uint32_t offset, LocaSubTable* loca) const {
   std::unique_ptr<SimpleGlyphData> data(new SimpleGlyphData());
-  const uint8_t* glyph = ptr_ + offset;
-  int16_t num_of_contours = readS16(glyph, 0);
-  if (num_of_contours > 0) 
+  if (!getGlyfHeader(offset, data.get()) || data->num_of_contours >= 0)
     LOG(FATAL) << "Simple glyph is specified.";
-  data->x_min = readS16(glyph, 2);
-  data->y_min = readS16(glyph, 4);
-  data->x_max = readS16(glyph, 6);
-  data->y_max = readS16(glyph, 8);
-  const size_t kCompositeGlyfOffset = 10;
-
-  uint16_t flag;
-  size_t composition_glyph_offset = kCompositeGlyfOffset;
+  // The components are decomposed the same way as for the glyph cache.
+  GlyphCache cache(*this, *loca, loca->num_glyphs());
+  if (!cache.decompose(offset, data.get()))
+    LOG(FATAL) << "Invalid composite glyph.";
+  return data;
+}
+
+bool GlyfSubTable::getComponents(uint32_t offset,
+                                 std::vector<GlyphComponent>* components,
+                                 std::vector<uint8_t>* instructions) const {
+  const uint8_t* p = ptr_ + offset + sizeof(GlyfHeader);
+  const uint8_t* end = ptr_ + length_;
+  components->clear();
+
+  GlyphComponent c;
   do {
-    flag = readU16(glyph, composition_glyph_offset );
-    LOG(ERROR) << std::hex << "0x" << flag;
-    uint16_t glyph_index = readU16(glyph, composition_glyph_offset + 2);
-    LOG(ERROR) << std::hex << "Glyph Index: " << glyph_index;
-
-    int16_t arg1, arg2;
-    size_t nextOffset;
-    if ((flag & 0x01) != 0) {
-      arg1 = readS16(glyph, composition_glyph_offset + 4);
-      arg2 = readS16(glyph, composition_glyph_offset + 6);
-      composition_glyph_offset += 8;
+    if (p + 4 > end)
+      return false;
+    const UInt16* header = recordAt<UInt16>(p, 0);
+    c.flags = header[0];
+    c.glyph_id = header[1];
+    p += 4;
+
+    const size_t arg_size = (c.flags & kArg1And2AreWords) ? 4 : 2;
+    if (p + arg_size > end)
+      return false;
+    if (c.flags & kArgsAreXyValues) {
+      c.arg1 = arg_size == 4 ? recordAt<Int16>(p, 0)->value() : (int8_t)p[0];
+      c.arg2 = arg_size == 4 ? recordAt<Int16>(p, 2)->value() : (int8_t)p[1];
     } else {
-      arg1 = (int8_t)glyph[composition_glyph_offset + 4];
-      arg2 = (int8_t)glyph[composition_glyph_offset + 5];
-      composition_glyph_offset += 6;
+      c.arg1 = arg_size == 4 ? recordAt<UInt16>(p, 0)->value() : p[0];
+      c.arg2 = arg_size == 4 ? recordAt<UInt16>(p, 2)->value() : p[1];
     }
-
-    if ((flag & 0x02) == 0) {
-      LOG(FATAL) << "Point coordinate is not supported.";
+    p += arg_size;
+
+    c.xx = c.yy = 1 << 14;
+    c.yx = c.xy = 0;
+    const F2Dot14* scale = recordAt<F2Dot14>(p, 0);
+    if (c.flags & kWeHaveAScale) {
+      if (p + 2 > end)
+        return false;
+      c.xx = c.yy = scale[0];
+      p += 2;
+    } else if (c.flags & kWeHaveAnXAndYScale) {
+      if (p + 4 > end)
+        return false;
+      c.xx = scale[0];
+      c.yy = scale[1];
+      p += 4;
+    } else if (c.flags & kWeHaveATwoByTwo) {
+      if (p + 8 > end)
+        return false;
+      c.xx = scale[0];
+      c.yx = scale[1];
+      c.xy = scale[2];
+      c.yy = scale[3];
+      p += 8;
     }
+    components->push_back(c);
+  } while (c.flags & kMoreComponents);
+
+  instructions->clear();
+  if (c.flags & kWeHaveInstructions) {
+    if (p + 2 > end)
+      return false;
+    uint16_t inst_length = *recordAt<UInt16>(p, 0);
+    if (p + 2 + inst_length > end)
+      return false;
+    instructions->assign(p + 2, p + 2 + inst_length);
+  }
+  return true;
+}
 
-    std::unique_ptr<SimpleGlyphData> compose_glyph = getSimpleGlyfData(
-        loca->findGlyfOffset(glyph_index));
+bool GlyfSubTable::getInstructions(uint32_t offset,
+                                   std::vector<uint8_t>* instructions) const {
+  const GlyfHeader* header = recordAt<GlyfHeader>(ptr_, length_, offset);
+  if (!header || header->number_of_contours < 0)
+    return false;
+  // The end points and the instruction length.
+  const UInt16* end_pts = recordAt<UInt16>(
+      ptr_, length_, offset + sizeof(GlyfHeader),
+      header->number_of_contours + 1);
+  if (!end_pts)
+    return false;
+  const UInt16& inst_length = end_pts[header->number_of_contours];
+  const uint8_t* inst = inst_length.bytes + sizeof(UInt16);
+  if (inst + inst_length > ptr_ + length_)
+    return false;
+  instructions->assign(inst, inst + inst_length);
+  return true;
+}
 
-    for (int i = 0; i < compose_glyph->contours.size(); ++i) {
-      for (int j = 0; j < compose_glyph->contours[i].points.size(); ++j) {
-        compose_glyph->contours[i].points[j].x += arg1;
-        compose_glyph->contours[i].points[j].y += arg2;
-      }
-      data->contours.push_back(compose_glyph->contours[i]);
-    }
+namespace {
 
-  } while ((flag & (1 << 5u)) != 0);
-  return data;
+// Multiplies by a 2.14 number, rounding half away from zero.
+int32_t mulF2Dot14(int32_t v, int32_t f) {
+  int64_t p = (int64_t)v * f;
+  return p >= 0 ? (int32_t)((p + (1 << 13)) >> 14)
+                : -(int32_t)((-p + (1 << 13)) >> 14);
 }
 
-std::unique_ptr<SimpleGlyphData> GlyfSubTable::getSimpleGlyfData(uint32_t offset) const {
-  const uint8_t* glyph = ptr_ + offset;
-  int16_t num_of_contours = readS16(glyph, 0);
-  if (num_of_contours < 0) 
-    LOG(FATAL) << "Composite glyph is specified.";
-  std::unique_ptr<SimpleGlyphData> data(new SimpleGlyphData());
-  data->num_of_contours = num_of_contours;
-  data->x_min = readS16(glyph, 2);
-  data->y_min = readS16(glyph, 4);
-  data->x_max = readS16(glyph, 6);
-  data->y_max = readS16(glyph, 8);
-
-  const size_t kSimpleGlyfOffset = 10;
-  const size_t instLengthOffset = kSimpleGlyfOffset + num_of_contours * 2;
-  size_t instLength = readU16(glyph, instLengthOffset);
-  data->instructions.resize(instLength);
-  memcpy(&data->instructions[0], glyph + instLengthOffset + 2, instLength);
-
-  const uint16_t total_pts =
-      readU16(glyph, kSimpleGlyfOffset + (num_of_contours - 1) * 2) + 1;
-  std::vector<uint8_t> flags;
-  size_t flagOffset = instLengthOffset + 2 + instLength;
-  for (; flags.size() < total_pts; ++flagOffset) {
-    uint8_t flag = glyph[flagOffset];
-    flags.push_back(flag);
-    if (flag & (1 << 3)) {
-      // repeate
-      uint8_t repeate_count = glyph[++flagOffset];
-      for (uint8_t j = 0; j < repeate_count; ++j) {
-        flags.push_back(flag);
-      }
+}  // namespace
+
+bool placeComponent(const GlyphComponent& component, const Outline& outline,
+                    Outline* out) {
+  const size_t base = out->numPoints();
+  const size_t n = outline.numPoints();
+  if (base + n > 0x10000)
+    return false;
+  const bool transformed = component.xx != (1 << 14) ||
+      component.yy != (1 << 14) || component.yx != 0 || component.xy != 0;
+
+  for (size_t i = 0; i < n; ++i) {
+    int32_t x = outline.x[i];
+    int32_t y = outline.y[i];
+    if (transformed) {
+      x = mulF2Dot14(outline.x[i], component.xx) +
+          mulF2Dot14(outline.y[i], component.xy);
+      y = mulF2Dot14(outline.x[i], component.yx) +
+          mulF2Dot14(outline.y[i], component.yy);
     }
-  }
-  if (flags.size() != total_pts) {
-    LOG(FATAL) << "Invalid count of flags: flags:" << flags.size() << ", total points: " << total_pts;
+    out->addPoint(x, y, outline.isOnCurve(i));
   }
 
-  size_t x_cord_offset = flagOffset;
-  int16_t prev_x = 0;
-  std::vector<int16_t> abs_x;
-  for (int pt = 0; pt < total_pts; ++pt) {
-    uint8_t flag = flags[pt];
-
-    int16_t x = 0;
-    if (flags[pt] & (1 << 1)) {
-      x = glyph[x_cord_offset];
-      x_cord_offset ++;
-      if (!(flags[pt] & (1 << 4))) 
-        x *= -1;
-    } else {
-      if (flags[pt] & (1 << 4)) {
-        x = 0;
-      } else {
-        x = readU16(glyph, x_cord_offset);
-        x_cord_offset += 2;
-      }
+  int32_t dx, dy;
+  if (component.flags & kArgsAreXyValues) {
+    dx = component.arg1;
+    dy = component.arg2;
+    // The offset is in the component space only if asked for. kRoundXyToGrid
+    // needs the pixel grid, so the offset stays in font units here.
+    if ((component.flags & kScaledComponentOffset) &&
+        !(component.flags & kUnscaledComponentOffset)) {
+      dx = mulF2Dot14(component.arg1, component.xx) +
+          mulF2Dot14(component.arg2, component.xy);
+      dy = mulF2Dot14(component.arg1, component.yx) +
+          mulF2Dot14(component.arg2, component.yy);
     }
-    abs_x.push_back(prev_x += x);
+  } else {
+    const size_t parent = component.arg1;
+    const size_t child = base + component.arg2;
+    if (parent >= base || child >= out->numPoints())
+      return false;
+    dx = out->x[parent] - out->x[child];
+    dy = out->y[parent] - out->y[child];
   }
 
-  size_t y_cord_offset = x_cord_offset;
-  int16_t prev_y = 0;
-  std::vector<int16_t> abs_y;
-  for (int pt = 0; pt < total_pts; ++pt) {
-    uint8_t flag = flags[pt];
-
-    int16_t y = 0;
-    if (flags[pt] & (1 << 2)) {
-      y = glyph[y_cord_offset];
-      y_cord_offset ++;
-      if (!(flags[pt] & (1 << 5))) 
-        y *= -1;
-    } else {
-      if (flags[pt] & (1 << 5)) {
-        y = 0;
-      } else {
-        y = readU16(glyph, y_cord_offset);
-        y_cord_offset += 2;
-      }
-    }
-    abs_y.push_back(prev_y += y);
+  for (size_t i = base; i < out->numPoints(); ++i) {
+    out->x[i] += dx;
+    out->y[i] += dy;
   }
+  for (size_t c = 0; c < outline.numContours(); ++c)
+    out->contour_ends.push_back(base + outline.contour_ends[c]);
+  return true;
+}
 
-  if (flags.size() != abs_x.size() || abs_x.size() != abs_y.size()) {
-    LOG(FATAL) << "Invalid point numbers.";
-  }
+std::unique_ptr<SimpleGlyphData> GlyfSubTable::getSimpleGlyfData(uint32_t offset) const {
+  std::unique_ptr<SimpleGlyphData> data(new SimpleGlyphData());
+  if (!getGlyfHeader(offset, data.get()))
+    LOG(FATAL) << "Invalid glyph offset.";
+  if (data->num_of_contours < 0)
+    LOG(FATAL) << "Composite glyph is specified.";
 
-  int pt = 0;
-  for (size_t c = 0; c < num_of_contours; ++c) {
-    data->contours.push_back(Contour());
-    Contour& contour = data->contours.back();
-    uint16_t end_pt_of_contour = readU16(glyph, kSimpleGlyfOffset + c * 2);
-    for (; pt <= end_pt_of_contour; ++pt) {
-      contour.points.push_back(GlyphPoint(abs_x[pt], abs_y[pt], flags[pt] & 0x01));
-    }
-  }
+  if (!getInstructions(offset, &data->instructions))
+    LOG(FATAL) << "Invalid instructions.";
+
+  std::vector<uint8_t> flags;
+  if (!decodeOutline(offset, coordinateKernel(), &flags, &data->outline))
+    LOG(FATAL) << "Invalid points.";
   return data;
 }
+
+bool GlyfSubTable::decodeOutline(uint32_t offset,
+                                 const CoordinateKernel& kernel,
+                                 std::vector<uint8_t>* flags,
+                                 Outline* outline) const {
+  const GlyfHeader* header = recordAt<GlyfHeader>(ptr_, length_, offset);
+  if (!header)
+    return false;
+  const uint8_t* end = ptr_ + length_;
+  int16_t num_of_contours = header->number_of_contours;
+  outline->clear();
+  if (num_of_contours <= 0)
+    return num_of_contours == 0;
+
+  // The end points and the instruction length.
+  const UInt16* end_pts = recordAt<UInt16>(
+      ptr_, length_, offset + sizeof(GlyfHeader), num_of_contours + 1);
+  if (!end_pts)
+    return false;
+  const UInt16& inst_length = end_pts[num_of_contours];
+  // The contours end in increasing order, so that each has a point.
+  for (int c = 1; c < num_of_contours; ++c) {
+    if (end_pts[c] <= end_pts[c - 1])
+      return false;
+  }
+  const uint32_t total_pts = end_pts[num_of_contours - 1] + 1;
+  flags->resize(total_pts);
+  const uint8_t* xs = expandFlags(inst_length.bytes + sizeof(UInt16) +
+                                  inst_length, end, &(*flags)[0], total_pts);
+  if (!xs)
+    return false;
+
+  outline->resize(total_pts);
+  packOnCurveBits(&(*flags)[0], total_pts, &outline->on_curve[0]);
+  const uint8_t* ys = kernel.decode(&(*flags)[0], total_pts, kXShortVector,
+                                    kXIsSameOrPositive, xs, end,
+                                    &outline->x[0]);
+  if (!ys || !kernel.decode(&(*flags)[0], total_pts, kYShortVector,
+                            kYIsSameOrPositive, ys, end, &outline->y[0])) {
+    return false;
+  }
+
+  outline->contour_ends.resize(num_of_contours);
+  for (int c = 0; c < num_of_contours; ++c)
+    outline->contour_ends[c] = end_pts[c];
+  return true;
+}
@@ -6,29 +6,36 @@
 #include <vector>
 #include <memory>
 #include <string>
-#include <sstream>
 
+#include "glyf_kernels.h"
 #include "loca.h"
+#include "outline.h"
+#include "utils.h"
 
-struct GlyphPoint {
-  GlyphPoint(int16_t x, int16_t y, bool on, bool interpolated) : x(x), y(y), on_curve(on), interpolated(interpolated) {}
-  GlyphPoint(int16_t x, int16_t y, bool on) : GlyphPoint(x, y, on, false) {}
-  int16_t x;
-  int16_t y;
-  bool on_curve;
-  bool interpolated;
-
-  std::string toString() const {
-    std::stringstream ss;
-    ss << "(" << x << ", " << y << "): ";
-    ss << (on_curve ? "ON" : "OFF");
-    return ss.str();
-  }
-};
+// The flags of the simple glyph points.
+const uint8_t kOnCurvePoint = 1 << 0;
+const uint8_t kXShortVector = 1 << 1;
+const uint8_t kYShortVector = 1 << 2;
+const uint8_t kRepeatFlag = 1 << 3;
+const uint8_t kXIsSameOrPositive = 1 << 4;
+const uint8_t kYIsSameOrPositive = 1 << 5;
 
-struct Contour {
-  std::vector<GlyphPoint> points;
-};
+// The flags of the composite glyph components.
+const uint16_t kArg1And2AreWords = 1 << 0;
+const uint16_t kArgsAreXyValues = 1 << 1;
+const uint16_t kRoundXyToGrid = 1 << 2;
+const uint16_t kWeHaveAScale = 1 << 3;
+const uint16_t kMoreComponents = 1 << 5;
+const uint16_t kWeHaveAnXAndYScale = 1 << 6;
+const uint16_t kWeHaveATwoByTwo = 1 << 7;
+const uint16_t kWeHaveInstructions = 1 << 8;
+const uint16_t kUseMyMetrics = 1 << 9;
+const uint16_t kOverlapCompound = 1 << 10;
+const uint16_t kScaledComponentOffset = 1 << 11;
+const uint16_t kUnscaledComponentOffset = 1 << 12;
+
+// Composite glyphs nested deeper than this are rejected.
+const int kMaxComponentDepth = 16;
 
 struct GlyfData {
   int16_t num_of_contours;
@@ -39,13 +46,40 @@ struct GlyfData {
 };
 
 struct SimpleGlyphData : public GlyfData {
+  SimpleGlyphData() : glyph_id(0), composite(false) {}
+
+  // Looks up the metrics placing the phantom points for hinting.
+  uint16_t glyph_id;
+  // Decomposed from a composite glyph, whose components are not hinted.
+  bool composite;
   std::vector<uint8_t> instructions;
-  std::vector<Contour> contours;
+  Outline outline;
 };
 
 struct CompositeGlyphData : public GlyfData {
 };
 
+// A component of a composite glyph. The points of the component are
+// transformed by x' = xx * x + xy * y, y' = yx * x + yy * y in 2.14, then
+// moved by (arg1, arg2). Without kArgsAreXyValues they are moved instead so
+// that the point arg2 of the component lands on the point arg1 of the glyph
+// so far.
+struct GlyphComponent {
+  uint16_t flags;
+  uint16_t glyph_id;
+  int32_t arg1;
+  int32_t arg2;
+  int32_t xx;
+  int32_t yx;
+  int32_t xy;
+  int32_t yy;
+};
+
+// Appends |component| of the decomposed |outline| to |out|. Returns false if
+// a matched point is out of range.
+bool placeComponent(const GlyphComponent& component, const Outline& outline,
+                    Outline* out);
+
 class GlyfSubTable {
  public:
   GlyfSubTable(const void* ptr, size_t length)
@@ -56,7 +90,134 @@ class GlyfSubTable {
   std::unique_ptr<SimpleGlyphData> getSimpleGlyfData(uint32_t offset) const;
   std::unique_ptr<SimpleGlyphData> getCompositeGlyfData(uint32_t offset, LocaSubTable* loca) const;
 
+  // Reads the components and the instructions of the composite glyph at
+  // |offset|.
+  bool getComponents(uint32_t offset, std::vector<GlyphComponent>* components,
+                     std::vector<uint8_t>* instructions) const;
+
+  // Reads the instructions of the simple glyph at |offset|.
+  bool getInstructions(uint32_t offset,
+                       std::vector<uint8_t>* instructions) const;
+
+  // Decodes the points of the simple glyph at |offset| into |outline| with
+  // the coordinate |kernel|. |flags| is a scratch buffer.
+  bool decodeOutline(uint32_t offset, const CoordinateKernel& kernel,
+                     std::vector<uint8_t>* flags, Outline* outline) const;
+
+  // Reads the number of contours and the bounding box of the glyph record at
+  // |offset|.
+  bool getGlyfHeader(uint32_t offset, GlyfData* header) const;
+
+  // Decodes the simple glyph at |offset| straight from the glyf bytes into
+  // path commands on |sink| (see ContourDecomposer) without any allocation.
+  // Returns false for a composite glyph or a broken record.
+  template <typename Sink>
+  bool decodeSimpleGlyf(uint32_t offset, Sink* sink) const;
+
  private:
+  // The record every glyph starts with. The end points of the contours
+  // follow it in a simple glyph, and the components in a composite one.
+  struct GlyfHeader {
+    Int16 number_of_contours;
+    FWord x_min;
+    FWord y_min;
+    FWord x_max;
+    FWord y_max;
+  };
+
   const uint8_t* ptr_;
   size_t length_;
 };
+
+template <typename Sink>
+bool GlyfSubTable::decodeSimpleGlyf(uint32_t offset, Sink* sink) const {
+  const GlyfHeader* header = recordAt<GlyfHeader>(ptr_, length_, offset);
+  if (!header)
+    return false;
+  const uint8_t* end = ptr_ + length_;
+  int16_t num_of_contours = header->number_of_contours;
+  if (num_of_contours <= 0)
+    return num_of_contours == 0;
+
+  // The end points and the instruction length.
+  const UInt16* end_pts = recordAt<UInt16>(
+      ptr_, length_, offset + sizeof(GlyfHeader), num_of_contours + 1);
+  if (!end_pts)
+    return false;
+  const UInt16& inst_length = end_pts[num_of_contours];
+  // The contours end in increasing order, so that each is closed.
+  for (int c = 1; c < num_of_contours; ++c) {
+    if (end_pts[c] <= end_pts[c - 1])
+      return false;
+  }
+  const uint8_t* flags = inst_length.bytes + sizeof(UInt16) + inst_length;
+  const uint32_t total_pts = end_pts[num_of_contours - 1] + 1;
+
+  // The flags tell where the x and y coordinates start.
+  const uint8_t* f = flags;
+  size_t x_bytes = 0;
+  size_t y_bytes = 0;
+  for (uint32_t pt = 0; pt < total_pts;) {
+    if (f >= end)
+      return false;
+    uint8_t flag = *f++;
+    uint32_t count = 1;
+    if (flag & kRepeatFlag) {
+      if (f >= end)
+        return false;
+      count += *f++;
+    }
+    if (count > total_pts - pt)
+      return false;
+    x_bytes += count * ((flag & kXShortVector) ? 1
+        : (flag & kXIsSameOrPositive) ? 0 : 2);
+    y_bytes += count * ((flag & kYShortVector) ? 1
+        : (flag & kYIsSameOrPositive) ? 0 : 2);
+    pt += count;
+  }
+  const uint8_t* xs = f;
+  const uint8_t* ys = xs + x_bytes;
+  if (ys + y_bytes > end)
+    return false;
+
+  ContourDecomposer<Sink> decomposer(sink);
+  int contour = 0;
+  uint32_t contour_end = end_pts[0];
+  int16_t x = 0;
+  int16_t y = 0;
+  uint8_t flag = 0;
+  uint32_t repeat = 0;
+  f = flags;
+  for (uint32_t pt = 0; pt < total_pts; ++pt) {
+    if (repeat == 0) {
+      flag = *f++;
+      if (flag & kRepeatFlag)
+        repeat = *f++;
+    } else {
+      --repeat;
+    }
+
+    if (flag & kXShortVector) {
+      x += (flag & kXIsSameOrPositive) ? *xs : -*xs;
+      ++xs;
+    } else if (!(flag & kXIsSameOrPositive)) {
+      x += *recordAt<Int16>(xs, 0);
+      xs += 2;
+    }
+    if (flag & kYShortVector) {
+      y += (flag & kYIsSameOrPositive) ? *ys : -*ys;
+      ++ys;
+    } else if (!(flag & kYIsSameOrPositive)) {
+      y += *recordAt<Int16>(ys, 0);
+      ys += 2;
+    }
+
+    decomposer.addPoint(x, y, flag & kOnCurvePoint);
+    if (pt == contour_end) {
+      decomposer.closeContour();
+      if (++contour < num_of_contours)
+        contour_end = end_pts[contour];
+    }
+  }
+  return true;
+}
@@ -0,0 +1,121 @@
+#include "glyf_kernels.h"
+
+#include <string.h>
+
+#include "cpu_features.h"
+#include "glyf.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+const uint8_t* expandFlags(const uint8_t* src, const uint8_t* end,
+                           uint8_t* flags, size_t n) {
+  size_t i = 0;
+  while (i < n) {
+#if defined(__SSE2__)
+    if (i + 16 <= n && end - src >= 16) {
+      // Most flags are not repeated. Copies 16 of them at once, and takes
+      // them up to the first one with the repeat bit. The rest is written
+      // again below.
+      __m128i v = _mm_loadu_si128((const __m128i*)src);
+      _mm_storeu_si128((__m128i*)(flags + i), v);
+      int mask = _mm_movemask_epi8(_mm_slli_epi16(v, 7 - 3));
+      if (mask == 0) {
+        src += 16;
+        i += 16;
+        continue;
+      }
+      int plain = __builtin_ctz(mask);
+      src += plain;
+      i += plain;
+    }
+#endif
+    if (src >= end)
+      return nullptr;
+    uint8_t flag = *src++;
+    size_t count = 1;
+    if (flag & kRepeatFlag) {
+      if (src >= end)
+        return nullptr;
+      count += *src++;
+    }
+    if (count > n - i)
+      return nullptr;
+#if defined(__SSE2__)
+    if (count <= 16 && i + 16 <= n) {
+      _mm_storeu_si128((__m128i*)(flags + i), _mm_set1_epi8(flag));
+      i += count;
+      continue;
+    }
+#endif
+    memset(flags + i, flag, count);
+    i += count;
+  }
+  return src;
+}
+
+void packOnCurveBits(const uint8_t* flags, size_t n, uint32_t* bits) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 32 <= n; i += 32) {
+    __m128i a = _mm_loadu_si128((const __m128i*)(flags + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(flags + i + 16));
+    uint32_t lo = _mm_movemask_epi8(_mm_slli_epi16(a, 7));
+    uint32_t hi = _mm_movemask_epi8(_mm_slli_epi16(b, 7));
+    bits[i >> 5] = lo | hi << 16;
+  }
+#endif
+  for (; i < n; i += 32) {
+    uint32_t word = 0;
+    for (size_t j = 0; j < 32 && i + j < n; ++j)
+      word |= (uint32_t)(flags[i + j] & kOnCurvePoint) << j;
+    bits[i >> 5] = word;
+  }
+}
+
+const uint8_t* decodeCoordinatesScalar(const uint8_t* flags, size_t n,
+                                       uint8_t short_bit, uint8_t same_bit,
+                                       const uint8_t* src, const uint8_t* end,
+                                       int32_t* out) {
+  return decodeCoordinatesScalarFrom(flags, n, short_bit, same_bit, src, end,
+                                     out, 0);
+}
+
+const uint8_t* decodeCoordinatesScalarFrom(const uint8_t* flags, size_t n,
+                                           uint8_t short_bit, uint8_t same_bit,
+                                           const uint8_t* src,
+                                           const uint8_t* end, int32_t* out,
+                                           int16_t value) {
+  for (size_t i = 0; i < n; ++i) {
+    uint8_t flag = flags[i];
+    if (flag & short_bit) {
+      if (src >= end)
+        return nullptr;
+      value += (flag & same_bit) ? *src : -*src;
+      ++src;
+    } else if (!(flag & same_bit)) {
+      if (end - src < 2)
+        return nullptr;
+      value += (int16_t)(src[0] << 8 | src[1]);
+      src += 2;
+    }
+    out[i] = value;
+  }
+  return src;
+}
+
+const CoordinateKernel& coordinateKernel() {
+  static const CoordinateKernel kernel = supportedCoordinateKernels().back();
+  return kernel;
+}
+
+std::vector<CoordinateKernel> supportedCoordinateKernels() {
+  std::vector<CoordinateKernel> kernels;
+  kernels.push_back({ "scalar", decodeCoordinatesScalar });
+#if defined(__x86_64__) || defined(__i386__)
+  if (cpuFeatures().ssse3)
+    kernels.push_back({ "ssse3", decodeCoordinatesSsse3 });
+#endif
+  return kernels;
+}
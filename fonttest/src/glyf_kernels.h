@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Expands the repeated flags of a simple glyph into |n| flags. Returns the
+// end of the flags in |src|, or nullptr if they are broken or run past |end|.
+const uint8_t* expandFlags(const uint8_t* src, const uint8_t* end,
+                           uint8_t* flags, size_t n);
+
+// Packs the on curve bits of |n| flags into a bitset, one bit per point.
+void packOnCurveBits(const uint8_t* flags, size_t n, uint32_t* bits);
+
+// Decodes the x or the y coordinates of |n| points. |short_bit| and
+// |same_bit| select the delta of each point from |flags|: one byte with
+// |same_bit| as its sign, zero, or two bytes. The deltas are summed into the
+// absolute coordinates in |out|, wrapping around in 16 bits as the format
+// does. Returns the end of the coordinates in |src|, or nullptr if they run
+// past |end|.
+typedef const uint8_t* (*DecodeKernel)(const uint8_t* flags, size_t n,
+                                       uint8_t short_bit, uint8_t same_bit,
+                                       const uint8_t* src, const uint8_t* end,
+                                       int32_t* out);
+
+struct CoordinateKernel {
+  const char* name;
+  DecodeKernel decode;
+};
+
+const uint8_t* decodeCoordinatesScalar(const uint8_t* flags, size_t n,
+                                       uint8_t short_bit, uint8_t same_bit,
+                                       const uint8_t* src, const uint8_t* end,
+                                       int32_t* out);
+const uint8_t* decodeCoordinatesSsse3(const uint8_t* flags, size_t n,
+                                      uint8_t short_bit, uint8_t same_bit,
+                                      const uint8_t* src, const uint8_t* end,
+                                      int32_t* out);
+
+// The scalar kernel continuing from the coordinate |value|. The vector
+// kernel finishes the points left over from its blocks with it.
+const uint8_t* decodeCoordinatesScalarFrom(const uint8_t* flags, size_t n,
+                                           uint8_t short_bit, uint8_t same_bit,
+                                           const uint8_t* src,
+                                           const uint8_t* end, int32_t* out,
+                                           int16_t value);
+
+// The fastest kernel the CPU supports, selected with cpuid once.
+const CoordinateKernel& coordinateKernel();
+
+// All the kernels the CPU supports.
+std::vector<CoordinateKernel> supportedCoordinateKernels();
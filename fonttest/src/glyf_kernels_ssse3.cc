@@ -0,0 +1,82 @@
+// Built with -mssse3. Only called when cpuid reports SSSE3, so this file must
+// not define anything shared with the other translation units.
+#include "glyf_kernels.h"
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+
+// Decodes eight points at a time. The byte size of each delta comes from the
+// flags, its offset in the stream is the prefix sum of the sizes, and pshufb
+// gathers the bytes of all the eight deltas into 16-bit lanes at once.
+const uint8_t* decodeCoordinatesSsse3(const uint8_t* flags, size_t n,
+                                      uint8_t short_bit, uint8_t same_bit,
+                                      const uint8_t* src, const uint8_t* end,
+                                      int32_t* out) {
+  const __m128i short_mask = _mm_set1_epi8(short_bit);
+  const __m128i same_mask = _mm_set1_epi8(same_bit);
+  const __m128i one = _mm_set1_epi8(1);
+  const __m128i zero_index = _mm_set1_epi8((char)0x80);
+  __m128i carry = _mm_setzero_si128();
+
+  size_t i = 0;
+  for (; i + 8 <= n && end - src >= 16; i += 8) {
+    __m128i f = _mm_loadl_epi64((const __m128i*)(flags + i));
+    __m128i is_short = _mm_cmpeq_epi8(_mm_and_si128(f, short_mask),
+                                      short_mask);
+    __m128i is_same = _mm_cmpeq_epi8(_mm_and_si128(f, same_mask), same_mask);
+    __m128i is_long = _mm_andnot_si128(_mm_or_si128(is_short, is_same),
+                                       _mm_cmpeq_epi8(f, f));
+
+    // 1, 2 or 0 bytes for each delta, and their offsets.
+    __m128i size = _mm_add_epi8(_mm_and_si128(is_short, one),
+                                _mm_and_si128(is_long, _mm_add_epi8(one, one)));
+    __m128i offset = _mm_add_epi8(size, _mm_slli_si128(size, 1));
+    offset = _mm_add_epi8(offset, _mm_slli_si128(offset, 2));
+    offset = _mm_add_epi8(offset, _mm_slli_si128(offset, 4));
+    int consumed = _mm_extract_epi16(offset, 3) >> 8;
+    offset = _mm_sub_epi8(offset, size);
+
+    // The low byte is the short delta or the second byte of a long one. The
+    // index with the top bit set makes pshufb write zero.
+    __m128i lo = _mm_add_epi8(offset, _mm_and_si128(is_long, one));
+    lo = _mm_or_si128(lo, _mm_and_si128(_mm_cmpeq_epi8(size, _mm_setzero_si128()),
+                                        zero_index));
+    __m128i hi = _mm_or_si128(offset, _mm_andnot_si128(is_long, zero_index));
+    __m128i shuffle = _mm_unpacklo_epi8(lo, hi);
+    __m128i delta = _mm_shuffle_epi8(
+        _mm_loadu_si128((const __m128i*)src), shuffle);
+
+    // Negative short deltas.
+    __m128i negative = _mm_andnot_si128(is_same, is_short);
+    negative = _mm_unpacklo_epi8(negative, negative);
+    delta = _mm_sub_epi16(_mm_xor_si128(delta, negative), negative);
+
+    __m128i sum = _mm_add_epi16(delta, _mm_slli_si128(delta, 2));
+    sum = _mm_add_epi16(sum, _mm_slli_si128(sum, 4));
+    sum = _mm_add_epi16(sum, _mm_slli_si128(sum, 8));
+    sum = _mm_add_epi16(sum, carry);
+    carry = _mm_shufflehi_epi16(sum, 0xFF);
+    carry = _mm_unpackhi_epi64(carry, carry);
+
+    _mm_storeu_si128((__m128i*)(out + i),
+                     _mm_srai_epi32(_mm_unpacklo_epi16(sum, sum), 16));
+    _mm_storeu_si128((__m128i*)(out + i + 4),
+                     _mm_srai_epi32(_mm_unpackhi_epi16(sum, sum), 16));
+    src += consumed;
+  }
+
+  return decodeCoordinatesScalarFrom(
+      flags + i, n - i, short_bit, same_bit, src, end, out + i,
+      (int16_t)_mm_extract_epi16(carry, 0));
+}
+
+#else
+
+const uint8_t* decodeCoordinatesSsse3(const uint8_t* flags, size_t n,
+                                      uint8_t short_bit, uint8_t same_bit,
+                                      const uint8_t* src, const uint8_t* end,
+                                      int32_t* out) {
+  return decodeCoordinatesScalar(flags, n, short_bit, same_bit, src, end, out);
+}
+
+#endif
@@ -0,0 +1,77 @@
+#include "glyph_cache.h"
+
+#include "loca.h"
+
+GlyphCache::GlyphCache(const GlyfSubTable& glyf, const LocaSubTable& loca,
+                       uint32_t num_glyphs)
+    : glyf_(glyf), loca_(loca), states_(num_glyphs, kNotLoaded),
+      glyphs_(num_glyphs) {}
+
+const SimpleGlyphData* GlyphCache::get(uint16_t glyph_id) {
+  if (glyph_id >= states_.size())
+    return nullptr;
+  if (states_[glyph_id] == kLoaded)
+    return glyphs_[glyph_id].get();
+  return load(glyph_id, 0);
+}
+
+const SimpleGlyphData* GlyphCache::load(uint16_t glyph_id, int depth) {
+  if (glyph_id >= states_.size())
+    return nullptr;
+  switch (states_[glyph_id]) {
+    case kLoaded:
+      return glyphs_[glyph_id].get();
+    case kLoading:  // A cycle.
+    case kBroken:
+      return nullptr;
+    case kNotLoaded:
+      break;
+  }
+
+  states_[glyph_id] = kLoading;
+  std::unique_ptr<SimpleGlyphData> data(new SimpleGlyphData());
+  data->glyph_id = glyph_id;
+  uint32_t offset = loca_.findGlyfOffset(glyph_id);
+  if (offset == loca_.findGlyfOffset(glyph_id + 1)) {
+    // No outline, like a space.
+    data->num_of_contours = 0;
+    data->x_min = data->y_min = data->x_max = data->y_max = 0;
+  } else if (!decode(offset, depth, data.get())) {
+    states_[glyph_id] = kBroken;
+    return nullptr;
+  }
+
+  states_[glyph_id] = kLoaded;
+  glyphs_[glyph_id].reset(data.release());
+  return glyphs_[glyph_id].get();
+}
+
+bool GlyphCache::decompose(uint32_t offset, SimpleGlyphData* data) {
+  return decode(offset, 0, data);
+}
+
+bool GlyphCache::decode(uint32_t offset, int depth, SimpleGlyphData* data) {
+  data->outline.clear();
+  data->instructions.clear();
+  if (!glyf_.getGlyfHeader(offset, data))
+    return false;
+  if (data->num_of_contours >= 0) {
+    return glyf_.decodeOutline(offset, coordinateKernel(), &flags_,
+                               &data->outline) &&
+        glyf_.getInstructions(offset, &data->instructions);
+  }
+
+  std::vector<GlyphComponent> components;
+  if (depth >= kMaxComponentDepth ||
+      !glyf_.getComponents(offset, &components, &data->instructions)) {
+    return false;
+  }
+  for (const GlyphComponent& c : components) {
+    const SimpleGlyphData* component = load(c.glyph_id, depth + 1);
+    if (!component || !placeComponent(c, component->outline, &data->outline))
+      return false;
+  }
+  data->num_of_contours = data->outline.numContours();
+  data->composite = true;
+  return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "glyf.h"
+
+class LocaSubTable;
+
+// Decoded glyphs by the glyph id. A composite glyph is decomposed into a
+// single outline once, and its components are looked up in the cache too,
+// so a base letter shared by accented letters is decoded only once.
+class GlyphCache {
+ public:
+  GlyphCache(const GlyfSubTable& glyf, const LocaSubTable& loca,
+             uint32_t num_glyphs);
+
+  // Returns the decomposed glyph, or nullptr for a broken glyph, including a
+  // composite glyph nested deeper than kMaxComponentDepth or containing
+  // itself.
+  const SimpleGlyphData* get(uint16_t glyph_id);
+
+  // Decomposes the glyph at |offset| into |data| without keeping it, looking
+  // its components up in the cache. Returns false for a broken glyph.
+  bool decompose(uint32_t offset, SimpleGlyphData* data);
+
+ private:
+  enum State : uint8_t {
+    kNotLoaded,
+    kLoading,
+    kLoaded,
+    kBroken,
+  };
+
+  const SimpleGlyphData* load(uint16_t glyph_id, int depth);
+
+  // Decodes the glyph at |offset| into |data|, loading the components of a
+  // composite glyph |depth| deep.
+  bool decode(uint32_t offset, int depth, SimpleGlyphData* data);
+
+  const GlyfSubTable& glyf_;
+  const LocaSubTable& loca_;
+  std::vector<State> states_;
+  std::vector<std::unique_ptr<SimpleGlyphData>> glyphs_;
+  std::vector<uint8_t> flags_;
+};
@@ -1,24 +1,49 @@
 #include "glyph_utils.h"
 
 #include <stddef.h>
-#include <stdint.h>
-#include "glyf.h"
+#include <algorithm>
+#include "fixed.h"
 
-std::vector<GlyphPoint> flattenPoints(const std::vector<GlyphPoint>& points) {
-  std::vector<GlyphPoint> out;
-  for (size_t j = 0; j < points.size(); ++j) {
-    const GlyphPoint* cur = &points[j];
-
-    size_t prev_idx = j == 0 ? points.size() - 1 : j - 1;
-    const GlyphPoint* prev = &points[prev_idx];
-
-    if (!prev->on_curve && !cur->on_curve) {
-      out.push_back(
-          GlyphPoint((cur->x + prev->x) / 2, (cur->y + prev->y) / 2, true, true));
-    }
+void scaleOutline(const Outline& outline, F16Dot16 scale, F26Dot6 x_origin,
+                  F26Dot6 y_origin, Outline* out) {
+  const size_t n = outline.numPoints();
+  out->x.resize(n);
+  out->y.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    out->x[i] = mulFix(outline.x[i], scale) - x_origin;
+    out->y[i] = mulFix(outline.y[i], scale) - y_origin;
+  }
+  out->on_curve = outline.on_curve;
+  out->contour_ends = outline.contour_ends;
+}
 
-    out.push_back(*cur);
+void placeHintedOutline(const Outline& outline, Outline* out, int* width,
+                        int* height, F26Dot6* x_origin, F26Dot6* y_origin) {
+  const size_t n = outline.numPoints();
+  F26Dot6 x_min = 0, y_min = 0, x_max = 0, y_max = 0;
+  if (n != 0) {
+    x_min = x_max = outline.x[0];
+    y_min = y_max = outline.y[0];
+  }
+  for (size_t i = 1; i < n; ++i) {
+    x_min = std::min(x_min, outline.x[i]);
+    x_max = std::max(x_max, outline.x[i]);
+    y_min = std::min(y_min, outline.y[i]);
+    y_max = std::max(y_max, outline.y[i]);
   }
+  x_min = pixelFloor(x_min);
+  y_min = pixelFloor(y_min);
+  *width = std::max(1, (pixelCeil(x_max) - x_min) / kF26Dot6One);
+  *height = std::max(1, (pixelCeil(y_max) - y_min) / kF26Dot6One);
+  *x_origin = x_min;
+  *y_origin = y_min;
 
-  return out;
+  out->x.resize(n);
+  out->y.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    out->x[i] = outline.x[i] - x_min;
+    out->y[i] = outline.y[i] - y_min;
+  }
+  out->on_curve = outline.on_curve;
+  out->contour_ends = outline.contour_ends;
 }
@@ -1,6 +1,42 @@
 #pragma once
 
-#include "glyf.h"
-#include <vector>
+#include "fixed.h"
+#include "outline.h"
 
-std::vector<GlyphPoint> flattenPoints(const std::vector<GlyphPoint>& points);
+// Scales the font unit outline by the 16.16 |scale| into 26.6 pixels
+// relative to (x_origin, y_origin) in 26.6 pixels.
+void scaleOutline(const Outline& outline, F16Dot16 scale, F26Dot6 x_origin,
+                  F26Dot6 y_origin, Outline* out);
+
+// Moves the hinted outline in 26.6 pixels so that the pixels covering it
+// start at the origin, and sets |width| and |height| to their numbers, at
+// least one each. (x_origin, y_origin) is set to the pixel the outline was
+// moved from.
+void placeHintedOutline(const Outline& outline, Outline* out, int* width,
+                        int* height, F26Dot6* x_origin, F26Dot6* y_origin);
+
+// A path sink forwarding the font unit path to |sink| scaled like
+// scaleOutline().
+template <typename Sink>
+class ScalingSink {
+ public:
+  ScalingSink(F16Dot16 scale, F26Dot6 x_origin, F26Dot6 y_origin, Sink* sink)
+      : scale_(scale), x_origin_(x_origin), y_origin_(y_origin),
+        sink_(sink) {}
+
+  void moveTo(int x, int y) { sink_->moveTo(scaleX(x), scaleY(y)); }
+  void lineTo(int x, int y) { sink_->lineTo(scaleX(x), scaleY(y)); }
+  void quadTo(int cx, int cy, int x, int y) {
+    sink_->quadTo(scaleX(cx), scaleY(cy), scaleX(x), scaleY(y));
+  }
+  void close() { sink_->close(); }
+
+ private:
+  F26Dot6 scaleX(int x) const { return mulFix(x, scale_) - x_origin_; }
+  F26Dot6 scaleY(int y) const { return mulFix(y, scale_) - y_origin_; }
+
+  F16Dot16 scale_;
+  F26Dot6 x_origin_;
+  F26Dot6 y_origin_;
+  Sink* sink_;
+};
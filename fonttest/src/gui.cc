@@ -1,7 +1,5 @@
 #include "gui.h"
 
-#include "glyph_utils.h"
-
 #include <goocanvas.h>
 #include <glog/logging.h>
 #include <sstream>
@@ -23,47 +21,46 @@ Gui::Gui(int w, int h, int cx, int cy, float scale, int margin)
   root_ = goo_canvas_get_root_item (GOO_CANVAS (canvas));
 }
 
-void Gui::drawPath(const std::vector<Contour>& contours, bool with_contours,
-    const std::string& color, bool close_path, float width) {
-  for (size_t i = 0; i < contours.size(); ++i) {
-    std::vector<GlyphPoint> points = flattenPoints(contours[i].points);
-    drawPath(points, with_contours, color, close_path, width);
-  }
-}
+// Builds an SVG path from the outline commands.
+class Gui::PathBuilder {
+ public:
+  PathBuilder(Gui* gui, bool close_path) : gui_(gui), close_path_(close_path) {}
 
-void Gui::drawPath(const std::vector<GlyphPoint>& points, bool with_contours,
-    const std::string& color, bool close_path, float width) {
-  std::stringstream ss;
-  for (size_t j = 0; j < points.size(); ++j) {
-    const GlyphPoint* cur = &points[j];
+  void moveTo(int x, int y) {
+    ss_ << "M " << gui_->toX(x) << " " << gui_->toY(y) << " ";
+  }
+  void lineTo(int x, int y) {
+    ss_ << "L " << gui_->toX(x) << " " << gui_->toY(y) << " ";
+  }
+  void quadTo(int cx, int cy, int x, int y) {
+    ss_ << "Q " << gui_->toX(cx) << " " << gui_->toY(cy)
+      << " " << gui_->toX(x) << " " << gui_->toY(y) << " ";
+  }
+  void close() {
+    if (close_path_)
+      ss_ << "Z ";
+  }
 
-    if (with_contours && !cur->interpolated)
-      drawPoint(cur->x, cur->y, 2.0, cur->on_curve ? "red" : "blue");
+  std::string str() const { return ss_.str(); }
 
-    size_t prev_idx = j == 0 ? points.size() - 1 : j - 1;
-    const GlyphPoint* prev = &points[prev_idx];
-    if (cur->on_curve) {
-      if (j == 0)
-        ss << "M " << toX(cur->x) << " " << toY(cur->y) << " ";
-      else if (prev->on_curve)
-        ss << "L " << toX(cur->x) << " " << toY(cur->y) << " ";
-      else
-        ss << "Q " << toX(prev->x) << " " << toY(prev->y)
-          << " " << toX(cur->x) << " " << toY(cur->y) << " ";
-      if (close_path && j == points.size() - 1)
-        ss << "Z";
-    } else {
+ private:
+  Gui* gui_;
+  bool close_path_;
+  std::stringstream ss_;
+};
 
-      if (!prev->on_curve)
-        LOG(FATAL) << "Should not happen";
-      if (j == points.size() - 1) {
-        const GlyphPoint* next = &points[0];
-        ss << "Q " << toX(cur->x) << " " << toY(cur->y) << " "
-          << toX(next->x) << " " << toY(next->y) << " ";
-      }
+void Gui::drawPath(const Outline& outline, bool with_contours,
+    const std::string& color, bool close_path, float width) {
+  if (with_contours) {
+    for (size_t i = 0; i < outline.numPoints(); ++i) {
+      drawPoint(outline.x[i], outline.y[i], 2.0,
+                outline.isOnCurve(i) ? "red" : "blue");
     }
   }
-  drawPath(ss.str(), color, width);
+
+  PathBuilder builder(this, close_path);
+  decomposeOutline(outline, &builder);
+  drawPath(builder.str(), color, width);
 }
 
 void Gui::drawPath(const std::string& command, const std::string& color, float width) {
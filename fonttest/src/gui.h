@@ -2,7 +2,7 @@
 
 #include <goocanvas.h>
 #include <string>
-#include "glyf.h"
+#include "outline.h"
 
 class Gui {
  public:
@@ -11,9 +11,7 @@ class Gui {
   Gui(int w, int h, int cx, int cy, float scale, int margin);
 
   void drawPath(const std::string& command, const std::string& color, float width);
-  void drawPath(const std::vector<Contour>& contours, bool with_contours,
-      const std::string& color, bool close_path, float width);
-  void drawPath(const std::vector<GlyphPoint>& contours, bool with_contours,
+  void drawPath(const Outline& outline, bool with_contours,
       const std::string& color, bool close_path, float width);
   void drawPoint(int x, int y, float width, const std::string& color);
 
@@ -22,6 +20,8 @@ class Gui {
   void fillRect(int x, int y, int w, int h, const std::string& color);
 
  private:
+  class PathBuilder;
+
   int w_;
   int h_;
   int cx_;
@@ -1,19 +1,33 @@
 #include "head.h"
 
-#include "utils.h"
+#include "big_endian.h"
 #include <glog/logging.h>
 
+namespace {
+
+struct HeadRecord {
+  UInt16 major_version;
+  UInt16 minor_version;
+  Fixed font_revision;
+  UInt32 checksum_adjustment;
+  UInt32 magic_number;
+  UInt16 flags;
+  UInt16 units_per_em;
+};
+
+}  // namespace
+
 HeadSubTable::HeadSubTable(const void* ptr, size_t length) {
-  uint8_t* bytes = (uint8_t*)ptr;
-  uint32_t major_version = readU16(bytes, 0);
-  uint32_t minor_version = readU16(bytes, 2);
-  if (major_version != 0x0001 || minor_version != 0x0000) {
+  const HeadRecord* head = recordAt<HeadRecord>(ptr, length, 0);
+  if (!head)
+    LOG(FATAL) << "Invalid head length: " << length;
+  if (head->major_version != 0x0001 || head->minor_version != 0x0000) {
     LOG(FATAL) << "unsupported head version";
   }
-  uint32_t magic = readU32(bytes, 12);
+  uint32_t magic = head->magic_number;
   if (magic != 0x5F0F3CF5) {
     LOG(FATAL) << "Unknown magic number: " << std::hex << magic;
   }
 
-  unit_per_em_ = readU16(bytes, 18);
+  unit_per_em_ = head->units_per_em;
 }
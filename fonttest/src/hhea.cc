@@ -0,0 +1,38 @@
+#include "hhea.h"
+
+#include "big_endian.h"
+#include <glog/logging.h>
+
+namespace {
+
+struct HheaRecord {
+  UInt16 major_version;
+  UInt16 minor_version;
+  FWord ascender;
+  FWord descender;
+  FWord line_gap;
+  UFWord advance_width_max;
+  FWord min_left_side_bearing;
+  FWord min_right_side_bearing;
+  FWord x_max_extent;
+  Int16 caret_slope_rise;
+  Int16 caret_slope_run;
+  Int16 caret_offset;
+  Int16 reserved[4];
+  Int16 metric_data_format;
+  UInt16 number_of_h_metrics;
+};
+
+}  // namespace
+
+HheaSubTable::HheaSubTable(const void* ptr, size_t length) {
+  const HheaRecord* hhea = recordAt<HheaRecord>(ptr, length, 0);
+  if (!hhea)
+    LOG(FATAL) << "Invalid hhea length: " << length;
+  if (hhea->major_version != 1)
+    LOG(FATAL) << "unsupported hhea version";
+
+  ascender_ = hhea->ascender;
+  descender_ = hhea->descender;
+  num_h_metrics_ = hhea->number_of_h_metrics;
+}
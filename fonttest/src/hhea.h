@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+class HheaSubTable {
+ public:
+  HheaSubTable(const void* ptr, size_t length);
+
+  int16_t ascender() const { return ascender_; }
+  int16_t descender() const { return descender_; }
+  uint16_t num_h_metrics() const { return num_h_metrics_; }
+
+ private:
+  int16_t ascender_;
+  int16_t descender_;
+  uint16_t num_h_metrics_;
+};
@@ -0,0 +1,137 @@
+#include "hint_program.h"
+
+#include <algorithm>
+
+#include "ttinst.h"
+
+namespace {
+
+// Marks the branch targets not resolved yet.
+const uint32_t kUnresolved = 0xFFFFFFFF;
+
+BranchKind branchOf(const HintInstruction& inst) {
+  return kInstructionInfo[inst.opcode].branch;
+}
+
+}  // namespace
+
+bool HintProgram::decode(const uint8_t* bytes, size_t length) {
+  instructions_.clear();
+  values_.clear();
+  offsets_.clear();
+  open_ifs_.clear();
+  uint32_t open_def = kUnresolved;
+  // The IFs and ELSEs open before the definition, which ELSE and EIF in it
+  // must not close.
+  size_t def_ifs = 0;
+
+  size_t pc = 0;
+  while (pc < length) {
+    HintInstruction inst;
+    inst.opcode = bytes[pc];
+    inst.count = 0;
+    inst.arg = 0;
+    const uint32_t index = instructions_.size();
+    offsets_.push_back(pc++);
+
+    const InstructionInfo& info = kInstructionInfo[inst.opcode];
+    const size_t value_bytes = info.operand_bytes;
+    if (value_bytes != 0) {
+      if (info.pushes == 0) {
+        if (pc >= length)
+          return false;
+        inst.count = bytes[pc++];
+      } else {
+        inst.count = info.pushes;
+      }
+      if (length - pc < inst.count * value_bytes)
+        return false;
+      inst.arg = values_.size();
+      for (int i = 0; i < inst.count; ++i) {
+        // The bytes are unsigned and the words are signed.
+        values_.push_back(value_bytes == 1 ? bytes[pc]
+                                           : (int16_t)(bytes[pc] << 8 |
+                                                       bytes[pc + 1]));
+        pc += value_bytes;
+      }
+    }
+
+    switch (info.branch) {
+      case BranchKind::kIf:
+        inst.arg = kUnresolved;
+        open_ifs_.push_back(index);
+        break;
+      case BranchKind::kElse:
+        // A false IF continues after its first ELSE. Every ELSE continues
+        // after the EIF.
+        if (open_def != kUnresolved && open_ifs_.size() <= def_ifs)
+          return false;
+        inst.arg = kUnresolved;
+        if (!open_ifs_.empty() &&
+            branchOf(instructions_[open_ifs_.back()]) == BranchKind::kIf &&
+            instructions_[open_ifs_.back()].arg == kUnresolved) {
+          instructions_[open_ifs_.back()].arg = index + 1;
+        }
+        open_ifs_.push_back(index);
+        break;
+      case BranchKind::kEndIf:
+        if (open_def != kUnresolved && open_ifs_.size() <= def_ifs)
+          return false;
+        while (!open_ifs_.empty() &&
+               branchOf(instructions_[open_ifs_.back()]) ==
+                   BranchKind::kElse) {
+          instructions_[open_ifs_.back()].arg = index + 1;
+          open_ifs_.pop_back();
+        }
+        if (!open_ifs_.empty()) {
+          if (instructions_[open_ifs_.back()].arg == kUnresolved)
+            instructions_[open_ifs_.back()].arg = index + 1;
+          open_ifs_.pop_back();
+        }
+        break;
+      case BranchKind::kDefinition:
+        // The definition ends at the first ENDF, and an IF jumping into or
+        // out of it would run its body at the top level, like
+        // PUSHB 0 IF PUSHB 7 FDEF EIF POP ENDF EIF, which the verifier
+        // does not see.
+        if (open_def != kUnresolved)
+          return false;
+        inst.arg = kUnresolved;
+        open_def = index;
+        def_ifs = open_ifs_.size();
+        break;
+      case BranchKind::kEndDefinition:
+        if (open_def != kUnresolved) {
+          if (open_ifs_.size() != def_ifs)
+            return false;
+          instructions_[open_def].arg = index + 1;
+          open_def = kUnresolved;
+        }
+        break;
+      default:
+        break;
+    }
+    instructions_.push_back(inst);
+  }
+  offsets_.push_back(length);
+
+  // The branches without their end go to the end of the program.
+  const uint32_t end = instructions_.size();
+  for (uint32_t i : open_ifs_)
+    instructions_[i].arg = end;
+  if (open_def != kUnresolved)
+    instructions_[open_def].arg = end;
+  return true;
+}
+
+bool HintProgram::findInstruction(int64_t byte_offset,
+                                  uint32_t* index) const {
+  if (byte_offset < 0 || byte_offset > offsets_.back())
+    return false;
+  std::vector<uint32_t>::const_iterator it =
+      std::lower_bound(offsets_.begin(), offsets_.end(), byte_offset);
+  if (*it != byte_offset)
+    return false;
+  *index = it - offsets_.begin();
+  return true;
+}
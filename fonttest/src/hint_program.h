@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// An instruction of a decoded hint program.
+struct HintInstruction {
+  uint8_t opcode;
+  // The number of values pushed by NPUSHB, NPUSHW, PUSHB and PUSHW.
+  uint16_t count;
+  // The first pushed value in HintProgram::values() for the push
+  // instructions. The instruction to continue from for IF when the condition
+  // is false, for ELSE, and for FDEF and IDEF, which skip the definition.
+  uint32_t arg;
+};
+
+// A hint program (fpgm, prep or the glyph instructions) decoded once before
+// running it. The inline push operands are moved into values(), and the
+// targets of IF, ELSE, FDEF and IDEF are resolved, so that the interpreter
+// never scans the bytes.
+class HintProgram {
+ public:
+  HintProgram() {}
+
+  HintProgram(const HintProgram&) = delete;
+  HintProgram& operator=(const HintProgram&) = delete;
+
+  // Decodes |length| bytes of instructions. Returns false if the push data
+  // runs past the end, the function definitions are nested or an IF, ELSE
+  // or EIF crosses the start or the end of a definition. The buffers
+  // are reused, so decoding every glyph into the same program stops
+  // allocating after the largest one.
+  bool decode(const uint8_t* bytes, size_t length);
+  bool decode(const std::vector<uint8_t>& bytes) {
+    return decode(bytes.empty() ? nullptr : &bytes[0], bytes.size());
+  }
+
+  size_t size() const { return instructions_.size(); }
+  const HintInstruction& operator[](size_t i) const {
+    return instructions_[i];
+  }
+
+  const std::vector<int32_t>& values() const { return values_; }
+
+  // Finds the instruction at |byte_offset| of the original bytes for the
+  // relative jumps. Returns false unless an instruction starts there or it
+  // is the end of the program.
+  bool findInstruction(int64_t byte_offset, uint32_t* index) const;
+
+  // The byte offset of the instruction |i| in the original bytes.
+  uint32_t byteOffset(size_t i) const { return offsets_[i]; }
+
+ private:
+  std::vector<HintInstruction> instructions_;
+  std::vector<int32_t> values_;
+  // One more than the instructions, ending with the length of the bytes.
+  std::vector<uint32_t> offsets_;
+  // The IF and ELSE instructions waiting for their EIF while decoding.
+  std::vector<uint32_t> open_ifs_;
+};
+
+// A function defined by FDEF or an instruction defined by IDEF, starting at
+// the instruction |start| of |program| and running to its ENDF. |program| is
+// nullptr if it is not defined.
+struct FunctionDef {
+  const HintProgram* program;
+  uint32_t start;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+// The program an instruction was decoded from. The functions run in the
+// program that defines them.
+enum class HintProgramKind : uint8_t {
+  kFont,
+  kControlValue,
+  kGlyph,
+};
+
+// The graphics state fields changed by an instruction.
+enum HintTraceField : uint32_t {
+  kTraceFreedomVector = 1 << 0,
+  kTraceProjectionVector = 1 << 1,
+  kTraceDualVector = 1 << 2,
+  kTraceZonePointers = 1 << 3,  // gep0, gep1 and gep2
+  kTraceReferencePoints = 1 << 4,  // rp0, rp1 and rp2
+  kTraceLoop = 1 << 5,
+  kTraceMinimumDistance = 1 << 6,
+  kTraceRoundState = 1 << 7,  // with the period, the phase and the threshold
+  kTraceAutoFlip = 1 << 8,
+  kTraceCutIn = 1 << 9,  // with the single width value
+  kTraceScanControl = 1 << 10,  // with the scan type
+  kTraceDelta = 1 << 11,  // the delta base and shift
+  kTraceInstructionControl = 1 << 12,
+};
+
+// The graphics state an instruction left, with the vectors in 2.14 and the
+// distances in 26.6.
+struct HintTraceState {
+  int16_t freedom_vector[2];
+  int16_t projection_vector[2];
+  int16_t dual_vector[2];
+  uint32_t gep[3];
+  uint32_t rp[3];
+  uint32_t loop;
+  int32_t minimum_distance;
+  int32_t round_state;
+  int32_t period;
+  int32_t phase;
+  int32_t threshold;
+  bool auto_flip;
+  int32_t control_value_cutin;
+  int32_t single_width_cutin;
+  int32_t single_width_value;
+  bool scan_control;
+  int32_t scan_type;
+  int32_t delta_base;
+  int32_t delta_shift;
+  uint32_t instruction_control;
+};
+
+// An instruction run by the tracing HintStackMachine.
+struct HintTraceRecord {
+  HintProgramKind program;
+  uint8_t opcode;
+  // The number of functions running.
+  uint16_t call_depth;
+  // The byte offset of the instruction in its program.
+  uint32_t pc;
+  // The number of values on the stack before the instruction.
+  uint32_t stack_depth;
+  // The HintTraceField bits of what the instruction changed.
+  uint32_t gs_changes;
+  // The new values of the fields in |gs_changes|. The others are not set.
+  HintTraceState gs;
+};
+
+// Keeps the last |capacity| records, overwriting the oldest one. Recording
+// never allocates.
+class HintTrace {
+ public:
+  explicit HintTrace(size_t capacity)
+      : records_(std::max<size_t>(capacity, 1)), count_(0) {}
+
+  HintTrace(const HintTrace&) = delete;
+  HintTrace& operator=(const HintTrace&) = delete;
+
+  void add(const HintTraceRecord& record) {
+    records_[count_ % records_.size()] = record;
+    ++count_;
+  }
+
+  size_t size() const {
+    return (size_t)std::min<uint64_t>(count_, records_.size());
+  }
+
+  // The |i|th oldest record kept.
+  const HintTraceRecord& operator[](size_t i) const {
+    return records_[(count_ - size() + i) % records_.size()];
+  }
+
+  // The number of records overwritten by the newer ones.
+  uint64_t dropped() const { return count_ - size(); }
+
+  void clear() { count_ = 0; }
+
+ private:
+  std::vector<HintTraceRecord> records_;
+  uint64_t count_;
+};
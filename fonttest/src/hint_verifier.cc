@@ -0,0 +1,323 @@
+#include "hint_verifier.h"
+
+#include <algorithm>
+
+#include "ttinst.h"
+
+namespace {
+
+const uint8_t kDUP = 0x20;
+const uint8_t kSWAP = 0x23;
+const uint8_t kCINDEX = 0x25;
+const uint8_t kSLOOP = 0x17;
+const uint8_t kFDEF = 0x2C;
+const uint8_t kLOOPCALL = 0x2A;
+const uint8_t kROLL = 0x8A;
+
+// The functions summarized while summarizing another are nested no deeper
+// than this, which bounds the recursion. The deeper ones are not proven.
+const int kMaxSummaryDepth = 64;
+
+}  // namespace
+
+HintVerifier::HintVerifier()
+    : functions_(nullptr), capacity_(0), summary_depth_(0) {}
+
+void HintVerifier::setFunctions(const std::vector<FunctionDef>* functions,
+                                size_t capacity) {
+  functions_ = functions;
+  capacity_ = (int32_t)std::min<size_t>(capacity, 0x7FFFFFFF);
+  Summary not_done = { Summary::kNotDone, 0, 0, 0, 0 };
+  summaries_.assign(functions->size(), not_done);
+  for (uint32_t n = 0; n < summaries_.size(); ++n)
+    summarize(n);
+}
+
+bool HintVerifier::verify(const HintProgram& program, bool may_define) {
+  if (!functions_)
+    return false;
+  return walk(program, 0, may_define, nullptr, &program_walk_);
+}
+
+bool HintVerifier::walk(const HintProgram& program, uint32_t start,
+                        bool may_define, Summary* summary, Walk* w) {
+  State& s = w->state;
+  s.depth = 0;
+  s.loop = 1;
+  s.values.clear();
+  w->num_open_ifs = 0;
+  w->lowest = 0;
+  w->highest = 0;
+  // A program starts on the empty stack, and a function may pop the values
+  // of its caller.
+  const int32_t floor = summary ? -capacity_ : 0;
+
+  for (uint32_t pc = start; pc < program.size(); ++pc) {
+    const HintInstruction& inst = program[pc];
+    const InstructionInfo& info = kInstructionInfo[inst.opcode];
+
+    switch (info.branch) {
+      case BranchKind::kIf: {
+        pop(&s);
+        w->lowest = std::min(w->lowest, s.depth);
+        if (w->num_open_ifs == w->open_ifs.size())
+          w->open_ifs.resize(w->num_open_ifs + 1);
+        OpenIf& open_if = w->open_ifs[w->num_open_ifs++];
+        open_if.skipped = s;
+        open_if.in_else = false;
+        break;
+      }
+      case BranchKind::kElse: {
+        if (w->num_open_ifs == 0)
+          return false;
+        OpenIf& open_if = w->open_ifs[w->num_open_ifs - 1];
+        // Only the first ELSE of an IF is taken.
+        if (open_if.in_else)
+          return false;
+        open_if.then_end = s;
+        s = open_if.skipped;
+        open_if.in_else = true;
+        break;
+      }
+      case BranchKind::kEndIf: {
+        if (w->num_open_ifs == 0)
+          return false;
+        const OpenIf& open_if = w->open_ifs[--w->num_open_ifs];
+        if (!merge(open_if.in_else ? open_if.then_end : open_if.skipped, &s))
+          return false;
+        break;
+      }
+      case BranchKind::kDefinition:
+        if (!may_define || summary)
+          return false;
+        if (inst.opcode == kFDEF) {
+          // The calls after it run the new definition, and so do the
+          // functions summarized with the old one, which are not redone.
+          const Value n = pop(&s);
+          if (!n.known)
+            return false;
+          if ((uint32_t)n.value < summaries_.size() &&
+              (*functions_)[n.value].program)
+            return false;
+        } else {
+          pop(&s);
+        }
+        w->lowest = std::min(w->lowest, s.depth);
+        // The definition is skipped.
+        pc = inst.arg - 1;
+        break;
+      case BranchKind::kEndDefinition:
+        if (!summary || w->num_open_ifs != 0)
+          return false;
+        summary->reach = -w->lowest;
+        summary->peak = w->highest;
+        summary->net = s.depth;
+        summary->loop = s.loop;
+        return true;
+      case BranchKind::kCall:
+        if (!call(inst, w))
+          return false;
+        break;
+      case BranchKind::kJump:
+        return false;
+      case BranchKind::kNone:
+        switch (info.effect) {
+          case StackEffect::kFixed:
+            if (inst.opcode == kDUP) {
+              Value top = peek(s, 1);
+              w->lowest = std::min(w->lowest, s.depth - 1);
+              push(&s, top);
+            } else if (inst.opcode == kSWAP || inst.opcode == kROLL) {
+              // The top value goes under the next one or two.
+              const int32_t n = inst.opcode == kSWAP ? 2 : 3;
+              Value moved[3];
+              for (int32_t i = 0; i < n; ++i)
+                moved[i] = pop(&s);
+              w->lowest = std::min(w->lowest, s.depth);
+              if (inst.opcode == kSWAP) {
+                push(&s, moved[0]);
+                push(&s, moved[1]);
+              } else {
+                push(&s, moved[1]);
+                push(&s, moved[0]);
+                push(&s, moved[2]);
+              }
+            } else {
+              Value top = peek(s, 1);
+              for (int i = 0; i < info.pops; ++i)
+                pop(&s);
+              w->lowest = std::min(w->lowest, s.depth);
+              if (inst.opcode == kSLOOP) {
+                if (top.known && top.value < 0)
+                  return false;
+                s.loop = top.known ? std::min(top.value, 0xFFFF)
+                                   : kUnknownLoop;
+              }
+              const Value unknown = { false, 0 };
+              for (int i = 0; i < info.pushes; ++i)
+                push(&s, unknown);
+            }
+            break;
+          case StackEffect::kPush:
+            for (int i = 0; i < inst.count; ++i) {
+              Value value = { true, program.values()[inst.arg + i] };
+              push(&s, value);
+            }
+            break;
+          case StackEffect::kLoop:
+            // Too few points would skip the instruction.
+            if (s.loop == kUnknownLoop || s.loop > capacity_)
+              return false;
+            for (int32_t i = 0; i < info.pops + s.loop; ++i)
+              pop(&s);
+            w->lowest = std::min(w->lowest, s.depth);
+            s.loop = 1;
+            break;
+          case StackEffect::kDelta: {
+            // Too few values would stop the deltas early.
+            const Value n = pop(&s);
+            if (!n.known || n.value < 0 || n.value > capacity_)
+              return false;
+            for (int32_t i = 0; i < 2 * n.value; ++i)
+              pop(&s);
+            w->lowest = std::min(w->lowest, s.depth);
+            break;
+          }
+          case StackEffect::kIndex: {
+            const Value k = pop(&s);
+            if (!k.known || k.value < 1 || k.value > capacity_)
+              return false;
+            const int32_t index = s.depth - k.value;
+            w->lowest = std::min(w->lowest, index);
+            const Value value = peek(s, k.value);
+            if (inst.opcode != kCINDEX) {
+              // MINDEX moves the value up and the ones above it down.
+              if (index >= 0)
+                s.values.erase(s.values.begin() + index);
+              else if (s.depth > 0)
+                s.values.erase(s.values.begin());
+              --s.depth;
+            }
+            push(&s, value);
+            break;
+          }
+          case StackEffect::kClear:
+            // The stack of the caller is not known.
+            if (summary)
+              return false;
+            s.depth = 0;
+            s.values.clear();
+            break;
+          case StackEffect::kUndefined:
+            return false;
+        }
+        break;
+    }
+
+    w->highest = std::max(w->highest, s.depth);
+    if (w->lowest < floor || w->highest > capacity_)
+      return false;
+  }
+  // A function has to end with ENDF.
+  return !summary && w->num_open_ifs == 0;
+}
+
+bool HintVerifier::call(const HintInstruction& inst, Walk* w) {
+  State& s = w->state;
+  const Value n = pop(&s);
+  Value count = { true, 1 };
+  if (inst.opcode == kLOOPCALL)
+    count = pop(&s);
+  w->lowest = std::min(w->lowest, s.depth);
+  if (!n.known || !count.known)
+    return false;
+  const Summary* summary = summarize(n.value);
+  if (!summary)
+    return false;
+
+  const Value unknown = { false, 0 };
+  for (int32_t i = 0; i < count.value; ++i) {
+    // The summary starts with the loop count of one.
+    if (s.loop != 1)
+      return false;
+    w->lowest = std::min(w->lowest, s.depth - summary->reach);
+    w->highest = std::max(w->highest, s.depth + summary->peak);
+    // The values the function reaches are not known anymore.
+    const int32_t kept = std::max(s.depth - summary->reach, 0);
+    if ((int32_t)s.values.size() > kept)
+      s.values.resize(kept);
+    s.depth += summary->net;
+    s.values.resize(std::max(s.depth, 0), unknown);
+    s.loop = summary->loop;
+    if (w->lowest < -capacity_ || w->highest > capacity_)
+      return false;
+    // Repeating it changes nothing more, unless it returns with another
+    // loop count, which the next time is refused above.
+    if (summary->net == 0 && summary->loop == 1)
+      break;
+  }
+  return true;
+}
+
+const HintVerifier::Summary* HintVerifier::summarize(uint32_t n) {
+  if (n >= summaries_.size())
+    return nullptr;
+  if (summaries_[n].status == Summary::kNotDone) {
+    if (summary_depth_ == kMaxSummaryDepth)
+      return nullptr;
+    ++summary_depth_;
+    summaries_[n].status = Summary::kInProgress;
+    const FunctionDef& def = (*functions_)[n];
+    Summary summary = { Summary::kProven, 0, 0, 0, 0 };
+    Walk w;
+    if (!def.program || !walk(*def.program, def.start, false, &summary, &w))
+      summary.status = Summary::kUnproven;
+    summaries_[n] = summary;
+    --summary_depth_;
+  }
+  // A function calling itself is in progress.
+  return summaries_[n].status == Summary::kProven ? &summaries_[n] : nullptr;
+}
+
+// static
+HintVerifier::Value HintVerifier::pop(State* state) {
+  Value value = { false, 0 };
+  if (state->depth > 0) {
+    value = state->values.back();
+    state->values.pop_back();
+  }
+  --state->depth;
+  return value;
+}
+
+// static
+void HintVerifier::push(State* state, Value value) {
+  if (state->depth >= 0)
+    state->values.push_back(value);
+  ++state->depth;
+}
+
+// static
+HintVerifier::Value HintVerifier::peek(const State& state, int32_t n) {
+  const int32_t index = state.depth - n;
+  if (index < 0 || index >= (int32_t)state.values.size()) {
+    Value unknown = { false, 0 };
+    return unknown;
+  }
+  return state.values[index];
+}
+
+// static
+bool HintVerifier::merge(const State& other, State* state) {
+  if (other.depth != state->depth)
+    return false;
+  if (other.loop != state->loop)
+    state->loop = kUnknownLoop;
+  for (size_t i = 0; i < state->values.size(); ++i) {
+    Value& value = state->values[i];
+    const Value& o = other.values[i];
+    if (!o.known || o.value != value.value)
+      value.known = false;
+  }
+  return true;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "hint_program.h"
+
+// Proves before a hint program runs that it never pops more values than the
+// stack has nor pushes more than it holds, and that its IF, ELSE and EIF are
+// balanced, so that it can run without checking the stack.
+//
+// The values pushed by the program are followed as constants, which gives
+// the counts of SLOOP, the DELTAs, CINDEX and MINDEX and the functions CALL
+// and LOOPCALL run. Each function is summarized once by how deep it reaches
+// into the stack of its caller and how much it leaves there. The programs
+// with jumps, undefined instructions or counts known only while running are
+// not proven.
+class HintVerifier {
+ public:
+  HintVerifier();
+
+  HintVerifier(const HintVerifier&) = delete;
+  HintVerifier& operator=(const HintVerifier&) = delete;
+
+  // Summarizes |functions| for the programs calling them on a stack of
+  // |capacity| values. |functions| is kept until the next call.
+  void setFunctions(const std::vector<FunctionDef>* functions,
+                    size_t capacity);
+
+  // Returns true if |program| is proven starting on the empty stack. Only
+  // the font program and the control value program may use FDEF and IDEF,
+  // and a program redefining a function is not proven.
+  // Verifying a program no larger than the ones before does not allocate.
+  bool verify(const HintProgram& program, bool may_define);
+
+ private:
+  // A stack value, known if the program pushed it as a constant.
+  struct Value {
+    bool known;
+    int32_t value;
+  };
+
+  // The stack at an instruction. |depth| is relative to the stack the walk
+  // starts on, and |values| are the ones pushed above it.
+  struct State {
+    int32_t depth;
+    // The count set by SLOOP, or kUnknownLoop.
+    int32_t loop;
+    std::vector<Value> values;
+  };
+
+  // An IF waiting for its EIF.
+  struct OpenIf {
+    // The state when the condition is false.
+    State skipped;
+    // The state at the ELSE, once met.
+    State then_end;
+    bool in_else;
+  };
+
+  // What a function does to the stack of its caller.
+  struct Summary {
+    enum Status { kNotDone, kInProgress, kProven, kUnproven };
+    Status status;
+    // How far below its start the function pops.
+    int32_t reach;
+    // How far above its start the stack grows.
+    int32_t peak;
+    // The depth it returns with relative to its start.
+    int32_t net;
+    // The loop count it returns with.
+    int32_t loop;
+  };
+
+  struct Walk {
+    State state;
+    std::vector<OpenIf> open_ifs;
+    size_t num_open_ifs;
+    int32_t lowest;
+    int32_t highest;
+  };
+
+  static const int32_t kUnknownLoop = -1;
+
+  // Walks |program| from |start| to its end, or to the ENDF into |summary|
+  // for a function.
+  bool walk(const HintProgram& program, uint32_t start, bool may_define,
+            Summary* summary, Walk* w);
+
+  // Applies the function call of |inst| to |w|.
+  bool call(const HintInstruction& inst, Walk* w);
+
+  // Returns the summary of the function |n|, or nullptr if it is not proven.
+  const Summary* summarize(uint32_t n);
+
+  static Value pop(State* state);
+  static void push(State* state, Value value);
+  static Value peek(const State& state, int32_t n);
+  // Merges |other| into |state| where two paths meet. Returns false if the
+  // stack depths differ.
+  static bool merge(const State& other, State* state);
+
+  const std::vector<FunctionDef>* functions_;
+  int32_t capacity_;
+  std::vector<Summary> summaries_;
+  // The number of functions being summarized.
+  int summary_depth_;
+  Walk program_walk_;
+};
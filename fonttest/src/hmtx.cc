@@ -0,0 +1,47 @@
+#include "hmtx.h"
+
+#include "big_endian.h"
+#include <algorithm>
+#include <glog/logging.h>
+
+namespace {
+
+struct LongHorMetric {
+  UFWord advance_width;
+  FWord left_side_bearing;
+};
+
+}  // namespace
+
+HmtxSubTable::HmtxSubTable(const void* ptr, size_t length,
+                           uint32_t num_h_metrics, uint32_t num_glyphs)
+    : ptr_((const uint8_t*)ptr), num_h_metrics_(num_h_metrics) {
+  if (num_h_metrics == 0 ||
+      !recordAt<LongHorMetric>(ptr, length, 0, num_h_metrics)) {
+    LOG(FATAL) << "Invalid hmtx length: " << length;
+  }
+  size_t rest = (length - num_h_metrics * sizeof(LongHorMetric)) /
+      sizeof(FWord);
+  num_bearings_ = num_h_metrics;
+  if (num_glyphs > num_h_metrics)
+    num_bearings_ += std::min<size_t>(num_glyphs - num_h_metrics, rest);
+}
+
+uint16_t HmtxSubTable::advance_width(uint16_t glyph_id) const {
+  if (glyph_id >= num_bearings_)
+    return 0;
+  uint32_t i = std::min<uint32_t>(glyph_id, num_h_metrics_ - 1);
+  return recordAt<LongHorMetric>(ptr_, i * sizeof(LongHorMetric))
+      ->advance_width;
+}
+
+int16_t HmtxSubTable::left_side_bearing(uint16_t glyph_id) const {
+  if (glyph_id >= num_bearings_)
+    return 0;
+  if (glyph_id < num_h_metrics_) {
+    return recordAt<LongHorMetric>(ptr_, glyph_id * sizeof(LongHorMetric))
+        ->left_side_bearing;
+  }
+  return *recordAt<FWord>(ptr_, num_h_metrics_ * sizeof(LongHorMetric) +
+                          (glyph_id - num_h_metrics_) * sizeof(FWord));
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The horizontal metrics of the glyphs. The glyphs after the last long
+// metric have its advance width.
+class HmtxSubTable {
+ public:
+  HmtxSubTable(const void* ptr, size_t length, uint32_t num_h_metrics,
+               uint32_t num_glyphs);
+
+  // Both are 0 for a glyph id out of range.
+  uint16_t advance_width(uint16_t glyph_id) const;
+  int16_t left_side_bearing(uint16_t glyph_id) const;
+
+ private:
+  const uint8_t* ptr_;
+  uint32_t num_h_metrics_;
+  // The glyphs with a left side bearing, which a short table may not cover.
+  uint32_t num_bearings_;
+};
@@ -2,293 +2,207 @@
 
 #include "fpgm.h"
 #include "cvt.h"
+#include "fixed.h"
+#include "font_face.h"
+#include "hhea.h"
+#include "hmtx.h"
+#include "maxp.h"
+#include "os2.h"
 #include "prep.h"
-#include "head.h"
-#include "truetype.h"
+#include "ttinst.h"
 
 #include <glog/logging.h>
-#include <iomanip>
-#include <stack>
-#include <math.h>
-#include <map>
-
-#define FOR_EACH_INSTRUCTIONS(V) \
-    V(SVTCA,0, 0x00, zero) \
-    V(SVTCA,1, 0x01, zero) \
-    V(SPVTCA,0, 0x02, zero) \
-    V(SPVTCA,1, 0x03, zero) \
-    V(SPVTL,0, 0x06, zero) \
-    V(SPVTL,1, 0x07, zero) \
-    V(SFVTL,0, 0x08, zero) \
-    V(SFVTL,1, 0x09, zero) \
-    V(SPVFS,0, 0x0A, zero) \
-    V(SFVFS,0, 0x0B, zero) \
-    V(GPV,0, 0x0C, zero) \
-    V(GFV,0, 0x0D, zero) \
-    V(SRP0, 0, 0x10, zero) \
-    V(SRP1, 0, 0x11, zero) \
-    V(SRP2, 0, 0x12, zero) \
-    V(SZPS, 0, 0x16, zero) \
-    V(SLOOP, 0, 0x17, zero) \
-    V(RTG, 0, 0x18, zero) \
-    V(ELSE, 0, 0x1B, zero) \
-    V(SCVTCI, 0, 0x1D, zero) \
-    V(DUP, 0, 0x20, zero) \
-    V(POP, 0, 0x21, zero) \
-    V(SWAP, 0, 0x23, zero) \
-    V(CINDEX, 0, 0x25, zero) \
-    V(MINDEX, 0, 0x26, zero) \
-    V(CALL, 0, 0x2B, zero) \
-    V(FDEF, 0, 0x2C, zero) \
-    V(ENDF, 0, 0x2D, zero) \
-    V(MDAP, 0, 0x2E, zero) \
-    V(MDAP, 1, 0x2F, zero) \
-    V(IUP,0, 0x30, zero) \
-    V(IUP,1, 0x31, zero) \
-    V(SHP,0, 0x32, zero) \
-    V(SHP,1, 0x33, zero) \
-    V(SHPIX,0, 0x38, zero) \
-    V(IP,0, 0x39, zero) \
-    V(MSIRP,0, 0x3A, zero) \
-    V(MSIRP,1, 0x3B, zero) \
-    V(ALIGNRP,1, 0x3C, zero) \
-    V(MIAP,0, 0x3E, zero) \
-    V(MIAP,1, 0x3F, zero) \
-    V(NPUSHB,0, 0x40, consume_n) \
-    V(WS,0, 0x42, zero) \
-    V(RS,0, 0x43, zero) \
-    V(WCVTP,0, 0x44, zero) \
-    V(RCVT,0, 0x45, zero) \
-    V(GC,0, 0x46, zero) \
-    V(GC,1, 0x47, zero) \
-    V(SCFS,0, 0x48, zero) \
-    V(MD,0, 0x49, zero) \
-    V(MD,1, 0x4A, zero) \
-    V(MPPEM, 0, 0x4B, zero) \
-    V(LT, 0, 0x50, zero) \
-    V(LTEQ, 0, 0x51, zero) \
-    V(GT, 0, 0x52, zero) \
-    V(GTEQ, 0, 0x53, zero) \
-    V(EQ, 0, 0x54, zero) \
-    V(NEQ, 0, 0x55, zero) \
-    V(IF, 0, 0x58, zero) \
-    V(EIF, 0, 0x59, zero) \
-    V(AND, 0, 0x5A, zero) \
-    V(OR, 0, 0x5B, zero) \
-    V(NOT, 0, 0x5C, zero) \
-    V(DELTAP1, 0, 0x5D, zero) \
-    V(SDB, 0, 0x5E, zero) \
-    V(SDS, 0, 0x5F, zero) \
-    V(ADD, 0, 0x60, zero) \
-    V(SUB, 0, 0x61, zero) \
-    V(DIV, 0, 0x62, zero) \
-    V(MUL, 0, 0x63, zero) \
-    V(ABS, 0, 0x64, zero) \
-    V(NEG, 0, 0x65, zero) \
-    V(FLOOR, 0, 0x66, zero) \
-    V(ROUND, 00, 0x68, zero) \
-    V(ROUND, 01, 0x69, zero) \
-    V(ROUND, 10, 0x6A, zero) \
-    V(ROUND, 11, 0x6B, zero) \
-    V(WCVTF, 0, 0x70, zero) \
-    V(DELTAC, 0, 0x73, zero) \
-    V(DELTAC, 0, 0x74, zero) \
-    V(DELTAC, 0, 0x75, zero) \
-    V(SROUND, 0, 0x76, zero) \
-    V(ROFF, 0, 0x7A, zero) \
-    V(RUTG, 0, 0x7C, zero) \
-    V(RDTG, 0, 0x7D, zero) \
-    V(SCANCTRL, 0, 0x85, zero) \
-    V(SDPVTL, 0, 0x86, zero) \
-    V(SDPVTL, 1, 0x87, zero) \
-    V(GETINFO, 0, 0x88, zero) \
-    V(ROLL, 0, 0x8A, zero) \
-    V(MAX, 0, 0x8B, zero) \
-    V(MIN, 0, 0x8C, zero) \
-    V(SCANTYPE, 0, 0x8D, zero) \
-    V(INSTCTRL, 0, 0x8E, zero) \
-    V(PUSHB, 000, 0xB0, consume1) \
-    V(PUSHB, 001, 0xB1, consume2) \
-    V(PUSHB, 010, 0xB2, consume3) \
-    V(PUSHB, 011, 0xB3, consume4) \
-    V(PUSHB, 100, 0xB4, consume5) \
-    V(PUSHB, 101, 0xB5, consume6) \
-    V(PUSHB, 110, 0xB6, consume7) \
-    V(PUSHB, 111, 0xB7, consume8) \
-    V(PUSHW, 000, 0xB8, consumeW1) \
-    V(PUSHW, 001, 0xB9, consumeW2) \
-    V(PUSHW, 010, 0xBA, consumeW3) \
-    V(PUSHW, 011, 0xBB, consumeW4) \
-    V(PUSHW, 100, 0xBC, consumeW5) \
-    V(PUSHW, 101, 0xBD, consumeW6) \
-    V(PUSHW, 110, 0xBE, consumeW7) \
-    V(PUSHW, 111, 0xBF, consumeW8) \
-    V(MIRP,00000, 0xE0, zero) \
-    V(MIRP,00001, 0xE1, zero) \
-    V(MIRP,00010, 0xE2, zero) \
-    V(MIRP,00011, 0xE3, zero) \
-    V(MIRP,00100, 0xE4, zero) \
-    V(MIRP,00101, 0xE5, zero) \
-    V(MIRP,00110, 0xE6, zero) \
-    V(MIRP,00111, 0xE7, zero) \
-    V(MIRP,01000, 0xE8, zero) \
-    V(MIRP,01001, 0xE9, zero) \
-    V(MIRP,01010, 0xEA, zero) \
-    V(MIRP,01011, 0xEB, zero) \
-    V(MIRP,01100, 0xEC, zero) \
-    V(MIRP,01101, 0xED, zero) \
-    V(MIRP,01110, 0xEE, zero) \
-    V(MIRP,01111, 0xEF, zero) \
-    V(MIRP,10000, 0xF0, zero) \
-    V(MIRP,10001, 0xF1, zero) \
-    V(MIRP,10010, 0xF2, zero) \
-    V(MIRP,10011, 0xF3, zero) \
-    V(MIRP,10100, 0xF4, zero) \
-    V(MIRP,10101, 0xF5, zero) \
-    V(MIRP,10110, 0xF6, zero) \
-    V(MIRP,10111, 0xF7, zero) \
-    V(MIRP,11000, 0xF8, zero) \
-    V(MIRP,11001, 0xF9, zero) \
-    V(MIRP,11010, 0xFA, zero) \
-    V(MIRP,11011, 0xFB, zero) \
-    V(MIRP,11100, 0xFC, zero) \
-    V(MIRP,11101, 0xFD, zero) \
-    V(MIRP,11110, 0xFE, zero) \
-    V(MIRP,11111, 0xFF, zero) \
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
 
 namespace {
 
-int zero(const std::vector<uint8_t>& inst, int pc) { return pc; }
-
-int consumeW(const std::vector<uint8_t>& inst, int pc, int n) {
-  std::stringstream ss;
-  ss << "[";
-  for (int i = 0; i < n; ++i) {
-    if (i != 0) ss << ", ";
-    int high = inst[pc++];
-    int low = inst[pc++];
-    ss << static_cast<int16_t>(high << 8 | low);
-  }
-  ss << "]";
-  LOG(ERROR) << "data: " << ss.str();
-  return pc;
-}
-
-int consume(const std::vector<uint8_t>& inst, int pc, int n) {
-  std::stringstream ss;
-  ss << "[";
-  for (int i = 0; i < n; ++i) {
-    if (i != 0) ss << ", ";
-    ss << (uint32_t)inst[pc++];
-  }
-  ss << "]";
-  LOG(ERROR) << "data: " << ss.str();
-  return pc;
-}
-
-int consume1(const std::vector<uint8_t>& inst, int pc) { return consume(inst, pc, 1); }
-int consume2(const std::vector<uint8_t>& inst, int pc) { return consume(inst, pc, 2); }
-int consume3(const std::vector<uint8_t>& inst, int pc) { return consume(inst, pc, 3); }
-int consume4(const std::vector<uint8_t>& inst, int pc) { return consume(inst, pc, 4); }
-int consume5(const std::vector<uint8_t>& inst, int pc) { return consume(inst, pc, 5); }
-int consume6(const std::vector<uint8_t>& inst, int pc) { return consume(inst, pc, 6); }
-int consume7(const std::vector<uint8_t>& inst, int pc) { return consume(inst, pc, 7); }
-int consume8(const std::vector<uint8_t>& inst, int pc) { return consume(inst, pc, 8); }
-
-int consumeW1(const std::vector<uint8_t>& inst, int pc) { return consumeW(inst, pc, 1); }
-int consumeW2(const std::vector<uint8_t>& inst, int pc) { return consumeW(inst, pc, 2); }
-int consumeW3(const std::vector<uint8_t>& inst, int pc) { return consumeW(inst, pc, 3); }
-int consumeW4(const std::vector<uint8_t>& inst, int pc) { return consumeW(inst, pc, 4); }
-int consumeW5(const std::vector<uint8_t>& inst, int pc) { return consumeW(inst, pc, 5); }
-int consumeW6(const std::vector<uint8_t>& inst, int pc) { return consumeW(inst, pc, 6); }
-int consumeW7(const std::vector<uint8_t>& inst, int pc) { return consumeW(inst, pc, 7); }
-int consumeW8(const std::vector<uint8_t>& inst, int pc) { return consumeW(inst, pc, 8); }
-
-int consume_n(const std::vector<uint8_t>& inst, int pc) {
-  int n = inst[pc++];
-  return consume(inst, pc, n);
-}
-
-struct Vector {
-  Vector(double x, double y) : x(x), y(y) {}
-
-  double x;
-  double y;
+// A unit vector in 2.14.
+struct UnitVector {
+  int16_t x;
+  int16_t y;
 };
 
-struct UnitVector {
-  UnitVector(double x, double y) : x_(x), y_(y) {
-    normalize();
-  }
+const UnitVector kXAxis = { kF2Dot14One, 0 };
+const UnitVector kYAxis = { 0, kF2Dot14One };
 
-  void normalize() {
-    if (x_ == 0.0 && y_ == 0.0)
-      return;
+// Sets |v| to the direction of (vx, vy) with the same integer approximation
+// as FreeType. The zero vector leaves |v| alone.
+void normalize(int32_t vx, int32_t vy, UnitVector* v) {
+  if (vx == 0 && vy == 0)
+    return;
 
-    double r = sqrt(x_ * x_ + y_ * y_);
-    x_ /= r;
-    y_ /= r;
+  int sx = 1, sy = 1;
+  uint32_t x = vx, y = vy;
+  if (vx < 0) {
+    x = 0u - x;
+    sx = -1;
+  }
+  if (vy < 0) {
+    y = 0u - y;
+    sy = -1;
+  }
+  if (x == 0) {
+    v->x = 0;
+    v->y = sy * kF2Dot14One;
+    return;
+  }
+  if (y == 0) {
+    v->x = sx * kF2Dot14One;
+    v->y = 0;
+    return;
   }
 
-  double x() const { return x_; }
-  double y() const { return y_; }
-  void set_x(double x) { x_ = x; normalize(); }
-  void set_y(double y) { y_ = y; normalize(); }
+  // Scales the vector so that its approximate length is between 2/3 and 4/3
+  // in 16.16, then refines the reciprocal of the length by Newton's method.
+  uint32_t l = x > y ? x + (y >> 1) : y + (x >> 1);
+  int shift = __builtin_clz(l);
+  shift -= 15 + (l >= (0xAAAAAAAAu >> shift));
+  if (shift > 0) {
+    x <<= shift;
+    y <<= shift;
+    l = x > y ? x + (y >> 1) : y + (x >> 1);
+  } else {
+    x >>= -shift;
+    y >>= -shift;
+    l >>= -shift;
+  }
 
- private:
-  double x_;
-  double y_;
+  int32_t b = 0x10000 - (int32_t)l;
+  int32_t x0 = x, y0 = y;
+  uint32_t u, w;
+  int32_t z;
+  do {
+    u = (uint32_t)(x0 + (x0 * b >> 16));
+    w = (uint32_t)(y0 + (y0 * b >> 16));
+    // The squared length wraps around 2^32, so the signed value is the
+    // difference from it.
+    z = -(int32_t)(u * u + w * w) / 0x200;
+    z = z * ((0x10000 + b) >> 8) / 0x10000;
+    b += z;
+  } while (z > 0);
+
+  v->x = sx * (int32_t)(u / 4);
+  v->y = sy * (int32_t)(w / 4);
+}
+
+// The flags of the points in a zone.
+const uint8_t kOnCurve = 1 << 0;
+const uint8_t kTouchedX = 1 << 1;
+const uint8_t kTouchedY = 1 << 2;
+
+// Points in the structure of arrays form: in font units, scaled into 26.6
+// pixels before hinting, and being hinted.
+struct Zone {
+  size_t size() const { return cur_x.size(); }
+
+  // Keeps the capacity, so a zone reused for every glyph stops allocating
+  // after the largest one.
+  void resize(size_t n) {
+    orus_x.resize(n);
+    orus_y.resize(n);
+    org_x.resize(n);
+    org_y.resize(n);
+    cur_x.resize(n);
+    cur_y.resize(n);
+    flags.resize(n);
+  }
+
+  std::vector<int32_t> orus_x;
+  std::vector<int32_t> orus_y;
+  std::vector<F26Dot6> org_x;
+  std::vector<F26Dot6> org_y;
+  std::vector<F26Dot6> cur_x;
+  std::vector<F26Dot6> cur_y;
+  std::vector<uint8_t> flags;
 };
 
-struct Context;
+// The glyph points are followed by the origin, the advance, the top and the
+// bottom of the glyph.
+const size_t kNumPhantomPoints = 4;
+
+// The zones selected by SZP0, SZP1, SZP2 and SZPS.
+const uint32_t kTwilightZone = 0;
+const uint32_t kGlyphZone = 1;
+
+typedef HintStackMachine::Context Context;
 
-#define V(name, variant, opcode, is_move) \
-  void name(int op, const uint8_t* is, size_t len, Context* ctx, int* pc);
+#define V(name, variant, code) \
+  void name(int opcode, const HintInstruction& inst, Context* ctx);
   FOR_EACH_INSTRUCTIONS(V)
 #undef V
+void UNKNOWN(int opcode, const HintInstruction& inst, Context* ctx);
+
+enum RoundState {
+  kRoundToHalfGrid = 0,
+  kRoundToGrid = 1,
+  kRoundToDoubleGrid = 2,
+  kRoundDownToGrid = 3,
+  kRoundUpToGrid = 4,
+  kRoundOff = 5,
+  kRoundSuper = 6,
+  kRoundSuper45 = 7,
+};
 
-struct Context {
-  Context(const SimpleGlyphData& glyph,
-      int grid_size,
-      const TrueType& tt)
-      : glyph(glyph), grid_size(grid_size),
-      contours(glyph.contours),
-      freedom_vector(1, 0),  // x-axis by default
-      projection_vector(1, 0), // x-axis by default
-      gep0(1), gep1(1), gep2(1),
-      rp0(0), rp1(0), rp2(0),
-      scan_control(false),
-      scan_type(0),
-      delta_base(9),
-      delta_shift(3),
-      instruction_control(0),
-      round_state(1),
-      control_value_cutin(17.0/16.0)
-  {
-    fpgm = tt.getFpgm();
-    cvt = tt.getCvt();
-    head = tt.getHead();
+struct GraphicsState {
+  GraphicsState()
+      : freedom_vector(kXAxis),
+        projection_vector(kXAxis),
+        dual_vector(kXAxis),
+        gep0(kGlyphZone), gep1(kGlyphZone), gep2(kGlyphZone),
+        rp0(0), rp1(0), rp2(0),
+        loop(1),
+        minimum_distance(kF26Dot6One),
+        round_state(kRoundToGrid),
+        period(kF26Dot6One), phase(0), threshold(0),
+        auto_flip(true),
+        control_value_cutin(68),  // 17/16 pixels
+        single_width_cutin(0),
+        single_width_value(0),
+        scan_control(false),
+        scan_type(0),
+        delta_base(9),
+        delta_shift(3),
+        instruction_control(0) {}
+
+  // Resets what each glyph program starts with regardless of the control
+  // value program.
+  void resetForGlyph() {
+    freedom_vector = projection_vector = dual_vector = kXAxis;
+    gep0 = gep1 = gep2 = kGlyphZone;
+    round_state = kRoundToGrid;
+    loop = 1;
   }
 
-  // input
-  const SimpleGlyphData& glyph;
-  const std::vector<uint8_t>* instructions;
-  const int grid_size;
-
-  // output
-  std::vector<Contour> contours;
-
-  // internal variables
-  std::unique_ptr<FpgmSubTable> fpgm;
-  std::unique_ptr<CvtSubTable> cvt;
-  std::unique_ptr<HeadSubTable> head;
-
-  std::map<uint8_t, uint32_t> func_map;
-  std::map<uint8_t, uint32_t> storage;
-  std::stack<uint32_t> stack;
+  // Sets the period, the phase and the threshold of SROUND and S45ROUND
+  // from |selector|. |grid_period| is one pixel in 2.14.
+  void setSuperRound(int32_t grid_period, uint32_t selector) {
+    switch (selector & 0xC0) {
+      case 0x00: period = grid_period / 2; break;
+      case 0x80: period = grid_period * 2; break;
+      default: period = grid_period; break;  // 0xC0 is reserved.
+    }
+    switch (selector & 0x30) {
+      case 0x00: phase = 0; break;
+      case 0x10: phase = period / 4; break;
+      case 0x20: phase = period / 2; break;
+      case 0x30: phase = period * 3 / 4; break;
+    }
+    if ((selector & 0x0F) == 0)
+      threshold = period - 1;
+    else
+      threshold = ((int32_t)(selector & 0x0F) - 4) * period / 8;
+    // Into 26.6.
+    period >>= 8;
+    phase >>= 8;
+    threshold >>= 8;
+  }
 
   UnitVector freedom_vector;
   UnitVector projection_vector;
+  // The projection vector of the original outline, set apart by SDPVTL.
+  UnitVector dual_vector;
 
   uint32_t gep0;
   uint32_t gep1;
@@ -299,665 +213,2225 @@ struct Context {
   uint32_t rp2;
 
   uint32_t loop;
+  F26Dot6 minimum_distance;
+
+  int round_state;
+  F26Dot6 period;
+  F26Dot6 phase;
+  F26Dot6 threshold;
+
+  bool auto_flip;
+  F26Dot6 control_value_cutin;
+  F26Dot6 single_width_cutin;
+  F26Dot6 single_width_value;
 
   bool scan_control;
   int scan_type;
   int delta_base;
   int delta_shift;
   uint32_t instruction_control;
-  int round_state;
-  double control_value_cutin;
-
-  void run(const uint8_t* inst_stream, size_t length) {
-    int pc = 0;
-    while (pc < length) {
-      uint8_t inst = inst_stream[pc++];
-      switch (inst) {
-#define V(name, variant, opcode, is_move) \
-        case opcode: \
-        name(opcode, inst_stream, length, this, &pc); break;
-        FOR_EACH_INSTRUCTIONS(V)
-#undef V
-        default:
-          LOG(FATAL) << "Uknown opcode pc = " << pc <<
-              ", 0x" << std::setfill('0') << std::setw(2)
-              << std::hex << (uint32_t)inst;
-      }
+};
+
+// A running function. ENDF goes back to |program| at |return_pc|, or runs
+// the function again from |start| while |count| is more than one.
+struct CallFrame {
+  const HintProgram* program;
+  uint32_t return_pc;
+  uint32_t start;
+  uint32_t count;
+};
+
+// The interpreter stack, allocated once for the deepest stack of the font.
+// It does not check the bounds, which the stack guard of the interpreter
+// loop checks before each instruction unless the program is verified.
+class HintStack {
+ public:
+  HintStack() : size_(0) {}
+
+  void reserve(size_t capacity) {
+    values_.resize(capacity);
+    size_ = 0;
+  }
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return values_.size(); }
+  void clear() { size_ = 0; }
+
+  void push(int32_t value) { values_[size_++] = value; }
+
+  int32_t top() const { return at(1); }
+
+  void pop() { --size_; }
+
+  // The |n|th element from the top, the top being 1.
+  int32_t& at(size_t n) { return values_[size_ - n]; }
+  int32_t at(size_t n) const { return values_[size_ - n]; }
+
+  // Moves the |n|th element from the top to the top.
+  void moveToTop(size_t n) {
+    int32_t value = at(n);
+    for (size_t i = size_ - n; i + 1 < size_; ++i)
+      values_[i] = values_[i + 1];
+    values_[size_ - 1] = value;
+  }
+
+ private:
+  std::vector<int32_t> values_;
+  size_t size_;
+};
+
+// Some fonts push more than maxStackElements.
+const size_t kStackMargin = 32;
+
+// The instructions run between the readings of the clock, a power of two.
+const uint32_t kDeadlineInterval = 4096;
+
+}  // namespace
+
+struct HintStackMachine::PrepState {
+  // Why the font program or the control value program was stopped, leaving
+  // the glyphs unhinted.
+  HintError error;
+  GraphicsState gs;
+  std::vector<FunctionDef> functions;
+  // The instructions defined by IDEF for each opcode.
+  std::vector<FunctionDef> instruction_defs;
+  std::vector<int32_t> storage;
+  std::vector<F26Dot6> cvt;
+  Zone twilight;
+};
+
+struct HintStackMachine::Context {
+  Context(const FontFace& face, int grid_size);
+
+  // Starts the font program and the control value program, which define the
+  // functions in |state|.
+  void loadPrep(PrepState* state) {
+    prep = state;
+    defining = state;
+    zp0 = zp1 = zp2 = &glyph_zone;
+    gs = state->gs;
+    updateVectors();
+    storage = state->storage;
+    cvt = state->cvt;
+    twilight_zone = state->twilight;
+    glyph_zone.resize(0);
+    contour_ends.clear();
+  }
+
+  // Keeps what the control value program leaves for the glyph programs,
+  // including the twilight points it places.
+  void savePrep(PrepState* state) const {
+    state->gs = gs;
+    state->storage = storage;
+    state->cvt = cvt;
+    state->twilight = twilight_zone;
+  }
+
+  // Starts the program of |glyph| from |state|. The containers keep their
+  // capacity, so this does not allocate after the largest glyph.
+  void loadGlyph(const PrepState& state, const SimpleGlyphData& glyph);
+
+  // Writes the hinted glyph points, without the phantom points.
+  void storeGlyph(Outline* outline) const;
+
+  // input
+  const FontFace& face;
+  const int ppem;
+  // From font units into 26.6 pixels.
+  const F16Dot16 scale;
+
+  // The points of the glyph and its phantom points, and the points of the
+  // twilight zone, which are not in the outline. The zone pointers refer to
+  // either of them by the zone pointers gep0, gep1 and gep2.
+  Zone glyph_zone;
+  std::vector<uint16_t> contour_ends;
+  Zone twilight_zone;
+  Zone* zp0;
+  Zone* zp1;
+  Zone* zp2;
+
+  // The functions defined so far, and where FDEF and IDEF define them.
+  // |defining| is nullptr in the glyph programs, which cannot define any.
+  const PrepState* prep;
+  PrepState* defining;
+  // INSTCTRL works only in the control value program.
+  bool in_control_value_program;
+
+  GraphicsState gs;
+  std::vector<int32_t> storage;
+  std::vector<F26Dot6> cvt;
+  HintStack stack;
+
+  // Set from the freedom and projection vectors by updateVectors(): the
+  // projection of the freedom vector in 2.14, and whether the points move
+  // along an axis by the distance as it is.
+  int32_t f_dot_p;
+  bool move_x_only;
+  bool move_y_only;
+
+  // The running program and the next instruction in it.
+  const HintProgram* program;
+  uint32_t pc;
+  std::vector<CallFrame> call_stack;
+
+  HintBudget budget;
+  // Set by fail() to stop the running program.
+  HintError error;
+
+  // Runs |p| to its end within |budget|. |Guard| allows each instruction on
+  // the stack, and |tracer| sees it before and after it runs. Returns false,
+  // with |error| set, if the program is stopped.
+  template <typename Guard, typename Tracer>
+  bool run(const HintProgram& p, Tracer* tracer);
+
+  // Stops the running program after the current instruction.
+  void fail(HintError reason) { error = reason; }
+
+  // Starts the function |def| from the instruction after the current one.
+  void call(const FunctionDef& def, uint32_t count) {
+    if (call_stack.size() >= budget.max_call_depth) {
+      fail(HintError::kCallDepth);
+      return;
     }
+    CallFrame frame = { program, pc, def.start, count };
+    call_stack.push_back(frame);
+    program = def.program;
+    pc = def.start;
   }
 
-  GlyphPoint* findPoint(size_t idx) {
-    size_t skipped = 0;
-    for (size_t i = 0; i < contours.size(); ++i) {
-      if (skipped + contours[i].points.size() >= idx) {
-        return &contours[i].points[idx - skipped];
-      } else {
-        skipped += contours[i].points.size();
-      }
+  // Returns the function |n|, or nullptr if it is not defined.
+  const FunctionDef* function(uint32_t n) {
+    if (n >= prep->functions.size() || !prep->functions[n].program) {
+      fail(HintError::kInvalidReference);
+      return nullptr;
+    }
+    return &prep->functions[n];
+  }
+
+  // Moves to |byte_offset| of the running program, relative to the current
+  // instruction.
+  void jump(int32_t byte_offset) {
+    int64_t target = (int64_t)program->byteOffset(pc - 1) + byte_offset;
+    if (!program->findInstruction(target, &pc))
+      fail(HintError::kInvalidReference);
+  }
+
+  // The cvt and storage accessors read zero and write nothing out of range,
+  // stopping the program.
+  F26Dot6 readCvt(size_t idx) {
+    if (idx >= cvt.size()) {
+      fail(HintError::kInvalidReference);
+      return 0;
+    }
+    return cvt[idx];
+  }
+
+  void writeCvt(size_t idx, F26Dot6 value) {
+    if (idx >= cvt.size()) {
+      fail(HintError::kInvalidReference);
+      return;
+    }
+    cvt[idx] = value;
+  }
+
+  int32_t readStorage(size_t idx) {
+    if (idx >= storage.size()) {
+      fail(HintError::kInvalidReference);
+      return 0;
+    }
+    return storage[idx];
+  }
+
+  void writeStorage(size_t idx, int32_t value) {
+    if (idx >= storage.size()) {
+      fail(HintError::kInvalidReference);
+      return;
     }
-    LOG(FATAL) << "Invalid position of the glyph point.";
+    storage[idx] = value;
+  }
+
+  // Like FreeType, the instructions repeated by SLOOP do nothing unless the
+  // stack has a point for every time, and skip the points out of their zone
+  // instead of stopping the program.
+  bool hasLoopPoints() {
+    if (stack.size() >= gs.loop)
+      return true;
+    gs.loop = 1;
+    return false;
+  }
+
+  // Returns false, stopping the program, if |zone| does not have the point
+  // |idx|.
+  bool hasPoint(const Zone& zone, uint32_t idx) {
+    if (idx < zone.size())
+      return true;
+    fail(HintError::kInvalidReference);
+    return false;
+  }
+
+  void updateVectors();
+
+  // The length of (dx, dy) along the projection vector.
+  F26Dot6 project(F26Dot6 dx, F26Dot6 dy) const {
+    const UnitVector& v = gs.projection_vector;
+    if (v.x == kF2Dot14One)
+      return dx;
+    if (v.y == kF2Dot14One)
+      return dy;
+    return dotFix14(dx, dy, v.x, v.y);
+  }
+
+  // The same along the dual projection vector, for the original outline.
+  F26Dot6 dualProject(F26Dot6 dx, F26Dot6 dy) const {
+    const UnitVector& v = gs.dual_vector;
+    if (v.x == kF2Dot14One)
+      return dx;
+    if (v.y == kF2Dot14One)
+      return dy;
+    return dotFix14(dx, dy, v.x, v.y);
   }
+
+  // Moves the point |p| of |zone| along the freedom vector so that its
+  // projection changes by |distance|, and marks it touched.
+  void move(Zone* zone, size_t p, F26Dot6 distance) {
+    const UnitVector& v = gs.freedom_vector;
+    if (move_x_only) {
+      zone->cur_x[p] += distance;
+      zone->flags[p] |= kTouchedX;
+      return;
+    }
+    if (move_y_only) {
+      zone->cur_y[p] += distance;
+      zone->flags[p] |= kTouchedY;
+      return;
+    }
+    if (v.x != 0) {
+      zone->cur_x[p] += mulDiv(distance, v.x, f_dot_p);
+      zone->flags[p] |= kTouchedX;
+    }
+    if (v.y != 0) {
+      zone->cur_y[p] += mulDiv(distance, v.y, f_dot_p);
+      zone->flags[p] |= kTouchedY;
+    }
+  }
+
+  // The same for the original position, which is never touched.
+  void moveOriginal(Zone* zone, size_t p, F26Dot6 distance) {
+    const UnitVector& v = gs.freedom_vector;
+    if (move_x_only) {
+      zone->org_x[p] += distance;
+      return;
+    }
+    if (move_y_only) {
+      zone->org_y[p] += distance;
+      return;
+    }
+    if (v.x != 0)
+      zone->org_x[p] += mulDiv(distance, v.x, f_dot_p);
+    if (v.y != 0)
+      zone->org_y[p] += mulDiv(distance, v.y, f_dot_p);
+  }
+
+  // Rounds |distance| by the round state, keeping its sign.
+  F26Dot6 round(F26Dot6 distance) const;
+};
+
+HintStackMachine::Context::Context(const FontFace& face, int grid_size)
+    : face(face), ppem(face.unit_per_em() / grid_size),
+      scale(pixelScale(ppem, face.unit_per_em())),
+      zp0(&glyph_zone), zp1(&glyph_zone), zp2(&glyph_zone),
+      prep(nullptr), defining(nullptr), in_control_value_program(false),
+      program(nullptr), pc(0), error(HintError::kNone) {
+  const MaxpSubTable& maxp = face.maxp();
+  stack.reserve(maxp.max_stack_elements() + kStackMargin);
+  storage.reserve(maxp.max_storage());
+  cvt.reserve(face.cvt().cvt().size());
+  call_stack.reserve(budget.max_call_depth);
+  updateVectors();
+}
+
+void HintStackMachine::Context::loadGlyph(const PrepState& state,
+                                          const SimpleGlyphData& glyph) {
+  prep = &state;
+  defining = nullptr;
+  in_control_value_program = false;
+  zp0 = zp1 = zp2 = &glyph_zone;
+  // The control value program may ask for the default state.
+  gs = (state.gs.instruction_control & 2) ? GraphicsState() : state.gs;
+  gs.resetForGlyph();
+  updateVectors();
+  storage = state.storage;
+  cvt = state.cvt;
+  twilight_zone = state.twilight;
+
+  const Outline& outline = glyph.outline;
+  const size_t n = outline.numPoints();
+  Zone& zone = glyph_zone;
+  zone.resize(n + kNumPhantomPoints);
+  for (size_t i = 0; i < n; ++i) {
+    zone.orus_x[i] = outline.x[i];
+    zone.orus_y[i] = outline.y[i];
+    zone.flags[i] = outline.isOnCurve(i) ? kOnCurve : 0;
+  }
+  contour_ends = outline.contour_ends;
+
+  // The phantom points are placed by the metrics the same way as FreeType.
+  // Without vmtx the height is the typographic one.
+  const int32_t origin =
+      glyph.x_min - face.hmtx().left_side_bearing(glyph.glyph_id);
+  const Os2SubTable& os2 = face.os2();
+  const int32_t ascender =
+      os2.empty() ? face.hhea().ascender() : os2.typo_ascender();
+  const int32_t descender =
+      os2.empty() ? face.hhea().descender() : os2.typo_descender();
+  const int32_t phantom_x[] = {
+    origin, origin + face.hmtx().advance_width(glyph.glyph_id), 0, 0
+  };
+  const int32_t phantom_y[] = {
+    0, 0, ascender, ascender - std::abs(ascender - descender)
+  };
+  for (size_t i = 0; i < kNumPhantomPoints; ++i) {
+    zone.orus_x[n + i] = phantom_x[i];
+    zone.orus_y[n + i] = phantom_y[i];
+    zone.flags[n + i] = 0;
+  }
+
+  for (size_t i = 0; i < zone.size(); ++i) {
+    zone.cur_x[i] = zone.org_x[i] = mulFix(zone.orus_x[i], scale);
+    zone.cur_y[i] = zone.org_y[i] = mulFix(zone.orus_y[i], scale);
+  }
+  // Only the current phantom points start on the grid.
+  zone.cur_x[n] = pixelRound(zone.cur_x[n]);
+  zone.cur_x[n + 1] = pixelRound(zone.cur_x[n + 1]);
+  zone.cur_y[n + 2] = pixelRound(zone.cur_y[n + 2]);
+  zone.cur_y[n + 3] = pixelRound(zone.cur_y[n + 3]);
+}
+
+void HintStackMachine::Context::storeGlyph(Outline* outline) const {
+  const Zone& zone = glyph_zone;
+  const size_t n = zone.size() - kNumPhantomPoints;
+  outline->x.assign(zone.cur_x.begin(), zone.cur_x.begin() + n);
+  outline->y.assign(zone.cur_y.begin(), zone.cur_y.begin() + n);
+  outline->on_curve.assign((n + 31) / 32, 0);
+  for (size_t i = 0; i < n; ++i)
+    outline->setOnCurve(i, zone.flags[i] & kOnCurve);
+  outline->contour_ends = contour_ends;
+}
+
+void HintStackMachine::Context::updateVectors() {
+  const UnitVector& fv = gs.freedom_vector;
+  const UnitVector& pv = gs.projection_vector;
+  if (fv.x == kF2Dot14One)
+    f_dot_p = pv.x;
+  else if (fv.y == kF2Dot14One)
+    f_dot_p = pv.y;
+  else
+    f_dot_p = ((int32_t)pv.x * fv.x + (int32_t)pv.y * fv.y) >> 14;
+  move_x_only = f_dot_p == kF2Dot14One && fv.x == kF2Dot14One;
+  move_y_only = f_dot_p == kF2Dot14One && !move_x_only &&
+      fv.y == kF2Dot14One;
+  // Nearly perpendicular vectors would move the points too far.
+  if (std::abs(f_dot_p) < 0x400)
+    f_dot_p = kF2Dot14One;
+}
+
+F26Dot6 HintStackMachine::Context::round(F26Dot6 distance) const {
+  F26Dot6 d = std::abs(distance);
+  F26Dot6 rounded;
+  switch (gs.round_state) {
+    case kRoundToHalfGrid:
+      rounded = pixelFloor(d) + kF26Dot6Half;
+      break;
+    case kRoundToGrid:
+      rounded = pixelRound(d);
+      break;
+    case kRoundToDoubleGrid:
+      rounded = (d + kF26Dot6Half / 2) & -kF26Dot6Half;
+      break;
+    case kRoundDownToGrid:
+      rounded = pixelFloor(d);
+      break;
+    case kRoundUpToGrid:
+      rounded = pixelCeil(d);
+      break;
+    case kRoundSuper:
+      rounded = ((d + gs.threshold - gs.phase) & -gs.period) + gs.phase;
+      if (rounded < 0)
+        rounded = gs.phase;
+      break;
+    case kRoundSuper45:
+      rounded = (d + gs.threshold - gs.phase) / gs.period * gs.period +
+          gs.phase;
+      if (rounded < 0)
+        rounded = gs.phase;
+      break;
+    default:
+      rounded = d;
+      break;
+  }
+  return distance >= 0 ? rounded : -rounded;
+}
+
+namespace {
+
+typedef void (*Handler)(int opcode, const HintInstruction& inst, Context* ctx);
+
+// The handler of each opcode, so that each instruction is dispatched by one
+// indirect call.
+struct HandlerTable {
+  HandlerTable() {
+    for (int i = 0; i < 256; ++i)
+      handlers[i] = UNKNOWN;
+#define V(name, variant, opcode) handlers[opcode] = name;
+    FOR_EACH_INSTRUCTIONS(V)
+#undef V
+  }
+
+  Handler handlers[256];
 };
 
-void SVTCA(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  if ((opcode & 1) == 0) {
-    LOG(ERROR) << "SVTCA[0] - Set Projection/Freedom Vector to Y-axis.";
-    ctx->freedom_vector = UnitVector(0, 1);
-    ctx->projection_vector = UnitVector(0, 1);
+const HandlerTable kHandlerTable;
+
+// SVTCA, SPVTCA and SFVTCA. The odd opcodes set the x axis.
+void setVectorsToAxis(int opcode, Context* ctx) {
+  const UnitVector& axis = (opcode & 1) ? kXAxis : kYAxis;
+  if (opcode < 4)
+    ctx->gs.projection_vector = ctx->gs.dual_vector = axis;
+  if ((opcode & 2) == 0)
+    ctx->gs.freedom_vector = axis;
+  ctx->updateVectors();
+}
+
+// Sets |v| to the direction from the point |p1| of zp2 to the point |p2| of
+// zp1, turned counterclockwise if |*rotate|. Coincident points give the x
+// axis and clear |*rotate|, the same as FreeType. A missing point leaves |v|
+// and stops the program.
+void setVectorToLine(uint32_t p1, uint32_t p2, bool original, bool* rotate,
+                     Context* ctx, UnitVector* v) {
+  const Zone& z1 = *ctx->zp2;
+  const Zone& z2 = *ctx->zp1;
+  if (!ctx->hasPoint(z1, p1) || !ctx->hasPoint(z2, p2))
+    return;
+  int32_t dx, dy;
+  if (original) {
+    dx = z2.org_x[p2] - z1.org_x[p1];
+    dy = z2.org_y[p2] - z1.org_y[p1];
   } else {
-    LOG(ERROR) << "SVTCA[1] - Set Projection/Freedom Vector to X-axis.";
-    ctx->freedom_vector = UnitVector(1, 0);
-    ctx->projection_vector = UnitVector(1, 0);
+    dx = z2.cur_x[p2] - z1.cur_x[p1];
+    dy = z2.cur_y[p2] - z1.cur_y[p1];
+  }
+  if (dx == 0 && dy == 0) {
+    dx = kF2Dot14One;
+    *rotate = false;
+  }
+  if (*rotate) {
+    int32_t t = dy;
+    dy = dx;
+    dx = -t;
+  }
+  normalize(dx, dy, v);
+}
+
+// The zone selected by SZP0, SZP1, SZP2 and SZPS, or nullptr, stopping the
+// program, if there is no such zone.
+Zone* findZone(uint32_t n, Context* ctx) {
+  if (n == kTwilightZone)
+    return &ctx->twilight_zone;
+  if (n == kGlyphZone)
+    return &ctx->glyph_zone;
+  ctx->fail(HintError::kInvalidReference);
+  return nullptr;
+}
+
+// The distance of the point |p| of |zone| from the point |ref_p| of
+// |ref_zone| in the original outline. The glyph points are measured in font
+// units before scaling, which keeps the distances between them exact.
+F26Dot6 originalDistance(const Zone& zone, uint32_t p,
+                         const Zone& ref_zone, uint32_t ref_p,
+                         const Context* ctx) {
+  if (ctx->gs.gep0 == kTwilightZone || ctx->gs.gep1 == kTwilightZone) {
+    return ctx->dualProject(zone.org_x[p] - ref_zone.org_x[ref_p],
+                            zone.org_y[p] - ref_zone.org_y[ref_p]);
+  }
+  return mulFix(ctx->dualProject(zone.orus_x[p] - ref_zone.orus_x[ref_p],
+                                 zone.orus_y[p] - ref_zone.orus_y[ref_p]),
+                ctx->scale);
+}
+
+// Keeps |distance| at least the minimum distance in the direction of
+// |original|.
+F26Dot6 keepMinimumDistance(F26Dot6 original, F26Dot6 distance,
+                            const GraphicsState& gs) {
+  if (original >= 0)
+    return std::max(distance, gs.minimum_distance);
+  return std::min(distance, -gs.minimum_distance);
+}
+
+// The movement of the DELTAP and DELTAC argument |arg| at the current size,
+// whose sizes start at |range| above the delta base.
+F26Dot6 deltaAt(uint32_t arg, int range, const Context* ctx) {
+  int ppem = ((arg & 0xF0) >> 4) + range + ctx->gs.delta_base;
+  if (ppem != ctx->ppem)
+    return 0;
+  int32_t step = (int32_t)(arg & 0xF) - 8;
+  if (step >= 0)
+    ++step;
+  return step * (1 << (6 - ctx->gs.delta_shift));
+}
+
+// Moves the point |p| of |zone| by (dx, dy) on the axes the freedom vector
+// |v| has, and marks it touched on them if |touch|.
+void shiftPoint(const UnitVector& v, F26Dot6 dx, F26Dot6 dy, bool touch,
+                Zone* zone, size_t p) {
+  if (v.x != 0) {
+    zone->cur_x[p] += dx;
+    if (touch)
+      zone->flags[p] |= kTouchedX;
+  }
+  if (v.y != 0) {
+    zone->cur_y[p] += dy;
+    if (touch)
+      zone->flags[p] |= kTouchedY;
+  }
+}
+
+// The same for the points from |begin| to |end|, exclusive, except the point
+// |skip| of |skip_zone|. The whole range is moved in straight loops and the
+// skipped point is put back afterwards.
+void shiftPoints(const UnitVector& v, F26Dot6 dx, F26Dot6 dy, bool touch,
+                 Zone* zone, size_t begin, size_t end,
+                 const Zone* skip_zone, size_t skip) {
+  if (begin >= end)
+    return;
+  const bool skipped = skip_zone == zone && skip >= begin && skip < end;
+  const uint8_t skip_flags = skipped ? zone->flags[skip] : 0;
+  uint8_t touched = 0;
+  if (v.x != 0) {
+    F26Dot6* x = zone->cur_x.data();
+    for (size_t i = begin; i < end; ++i)
+      x[i] += dx;
+    if (skipped)
+      x[skip] -= dx;
+    touched |= kTouchedX;
+  }
+  if (v.y != 0) {
+    F26Dot6* y = zone->cur_y.data();
+    for (size_t i = begin; i < end; ++i)
+      y[i] += dy;
+    if (skipped)
+      y[skip] -= dy;
+    touched |= kTouchedY;
+  }
+  if (touch && touched) {
+    uint8_t* flags = zone->flags.data();
+    for (size_t i = begin; i < end; ++i)
+      flags[i] |= touched;
+    if (skipped)
+      flags[skip] = skip_flags;
   }
 }
 
-void WS(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
+// SHP, SHC and SHZ move the points as far as the reference point has moved
+// along the projection vector: rp1 of zp0 for the odd opcodes, and rp2 of
+// zp1 for the others.
+struct ReferenceShift {
+  const Zone* zone;
+  uint32_t point;
+  F26Dot6 dx;
+  F26Dot6 dy;
+};
+
+// Returns false if the reference point is missing.
+bool referenceShift(int opcode, Context* ctx, ReferenceShift* shift) {
+  shift->zone = (opcode & 1) ? ctx->zp0 : ctx->zp1;
+  shift->point = (opcode & 1) ? ctx->gs.rp1 : ctx->gs.rp2;
+  const Zone& zone = *shift->zone;
+  const uint32_t p = shift->point;
+  if (!ctx->hasPoint(zone, p))
+    return false;
+  const F26Dot6 distance = ctx->project(zone.cur_x[p] - zone.org_x[p],
+                                        zone.cur_y[p] - zone.org_y[p]);
+  shift->dx = mulDiv(distance, ctx->gs.freedom_vector.x, ctx->f_dot_p);
+  shift->dy = mulDiv(distance, ctx->gs.freedom_vector.y, ctx->f_dot_p);
+  return true;
+}
+
+// IUP works on one axis at a time, given the font unit, the original and the
+// current coordinates on it. The ranges below are inclusive and never contain
+// the touched points they follow.
+
+// Moves the points from |begin| to |end| with the touched point |ref|, the
+// only one of their contour.
+void iupShift(const F26Dot6* org, F26Dot6* cur, size_t begin, size_t end,
+              size_t ref) {
+  const F26Dot6 delta = cur[ref] - org[ref];
+  if (delta == 0)
+    return;
+  for (size_t i = begin; i <= end; ++i)
+    cur[i] += delta;
+  cur[ref] -= delta;
+}
+
+// Moves the points from |begin| to |end| between the touched points |ref1|
+// and |ref2|. The points between them in the original outline are
+// interpolated in font units, and the others move with the nearer one.
+void iupInterpolate(const int32_t* orus, const F26Dot6* org, F26Dot6* cur,
+                    size_t begin, size_t end, size_t ref1, size_t ref2) {
+  if (begin > end)
+    return;
+  if (orus[ref1] > orus[ref2])
+    std::swap(ref1, ref2);
+  const int32_t orus1 = orus[ref1];
+  const int32_t orus2 = orus[ref2];
+  const F26Dot6 org1 = org[ref1];
+  const F26Dot6 org2 = org[ref2];
+  const F26Dot6 cur1 = cur[ref1];
+  const F26Dot6 cur2 = cur[ref2];
+  const F26Dot6 delta1 = cur1 - org1;
+  const F26Dot6 delta2 = cur2 - org2;
+  // Without the room to interpolate the points between snap to |cur1|,
+  // which the zero scale gives as well.
+  const F16Dot16 scale = (cur1 == cur2 || orus1 == orus2)
+      ? 0 : divFix(cur2 - cur1, orus2 - orus1);
+  for (size_t i = begin; i <= end; ++i) {
+    const F26Dot6 x = org[i];
+    const F26Dot6 between = cur1 + mulFix(orus[i] - orus1, scale);
+    cur[i] = x <= org1 ? x + delta1 : x >= org2 ? x + delta2 : between;
+  }
+}
+
+void SVTCA(int opcode, const HintInstruction& inst, Context* ctx) {
+  setVectorsToAxis(opcode, ctx);
+}
+
+void WS(int opcode, const HintInstruction& inst, Context* ctx) {
   uint32_t value = ctx->stack.top(); ctx->stack.pop();
   uint32_t location = ctx->stack.top(); ctx->stack.pop();
-  ctx->storage[location] = value;
-  LOG(ERROR) << "WS: storage[" << location << "] <- " << value;
+  ctx->writeStorage(location, value);
 }
 
-void RS(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
+void RS(int opcode, const HintInstruction& inst, Context* ctx) {
   uint32_t location = ctx->stack.top(); ctx->stack.pop();
-  uint32_t value = ctx->storage[location];
+  uint32_t value = ctx->readStorage(location);
   ctx->stack.push(value);
-  LOG(ERROR) << "RS: storage[" << location << "] -> " << value;
 }
 
-void WCVTP(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  uint32_t value = ctx->stack.top(); ctx->stack.pop();
+void WCVTP(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 value = ctx->stack.top(); ctx->stack.pop();
   uint32_t location = ctx->stack.top(); ctx->stack.pop();
-  LOG(ERROR) << "WCVTP : cvt[" << location << "] <- " << value;
-  (*ctx->cvt)[location] = value;
+  ctx->writeCvt(location, value);
 }
 
-void RCVT(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
+void RCVT(int opcode, const HintInstruction& inst, Context* ctx) {
   uint32_t location = ctx->stack.top(); ctx->stack.pop();
-  uint32_t value = (*ctx->cvt)[location];
-  LOG(ERROR) << "RCVT: cvt[" << location << "] -> " << value;
+  F26Dot6 value = ctx->readCvt(location);
   ctx->stack.push(value);
 }
 
-void GC(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void GC(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t p = ctx->stack.top(); ctx->stack.pop();
+  const Zone& zone = *ctx->zp2;
+  if (!ctx->hasPoint(zone, p))
+    return;
+  F26Dot6 value = (opcode & 1)
+      ? ctx->dualProject(zone.org_x[p], zone.org_y[p])
+      : ctx->project(zone.cur_x[p], zone.cur_y[p]);
+  ctx->stack.push(value);
 }
 
-void SCFS(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void SCFS(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 value = ctx->stack.top(); ctx->stack.pop();
+  uint32_t p = ctx->stack.top(); ctx->stack.pop();
+  Zone* zone = ctx->zp2;
+  if (!ctx->hasPoint(*zone, p))
+    return;
+  ctx->move(zone, p, value - ctx->project(zone->cur_x[p], zone->cur_y[p]));
+  if (ctx->gs.gep2 == kTwilightZone) {
+    zone->org_x[p] = zone->cur_x[p];
+    zone->org_y[p] = zone->cur_y[p];
+  }
 }
 
-void MD(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void MD(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t p1 = ctx->stack.top(); ctx->stack.pop();
+  uint32_t p2 = ctx->stack.top(); ctx->stack.pop();
+  const Zone& z1 = *ctx->zp1;
+  const Zone& z2 = *ctx->zp0;
+  if (!ctx->hasPoint(z1, p1) || !ctx->hasPoint(z2, p2))
+    return;
+  F26Dot6 distance;
+  if (opcode & 1) {
+    distance = ctx->project(z2.cur_x[p2] - z1.cur_x[p1],
+                            z2.cur_y[p2] - z1.cur_y[p1]);
+  } else {
+    distance = originalDistance(z2, p2, z1, p1, ctx);
+  }
+  ctx->stack.push(distance);
 }
 
-void MPPEM(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  ctx->stack.push(ctx->head->unit_per_em() / ctx->grid_size);
-  LOG(ERROR) << __FUNCTION__ << ": " << ctx->stack.top();
+void MPPEM(int opcode, const HintInstruction& inst, Context* ctx) {
+  ctx->stack.push(ctx->ppem);
 }
 
-void LT(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  uint32_t left = ctx->stack.top(); ctx->stack.pop();
-  uint32_t right = ctx->stack.top(); ctx->stack.pop();
-  ctx->stack.push(left > right ? 1 : 0);
-  LOG(ERROR) << __FUNCTION__ << " : " << left << ", " << right << " -> " << ctx->stack.top();
+void LT(int opcode, const HintInstruction& inst, Context* ctx) {
+  int32_t right = ctx->stack.top(); ctx->stack.pop();
+  int32_t left = ctx->stack.top(); ctx->stack.pop();
+  ctx->stack.push(left < right ? 1 : 0);
 }
 
-void LTEQ(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  uint32_t left = ctx->stack.top(); ctx->stack.pop();
-  uint32_t right = ctx->stack.top(); ctx->stack.pop();
-  ctx->stack.push(left >= right ? 1 : 0);
-  LOG(ERROR) << __FUNCTION__ << " : " << left << ", " << right << " -> " << ctx->stack.top();
+void LTEQ(int opcode, const HintInstruction& inst, Context* ctx) {
+  int32_t right = ctx->stack.top(); ctx->stack.pop();
+  int32_t left = ctx->stack.top(); ctx->stack.pop();
+  ctx->stack.push(left <= right ? 1 : 0);
 }
 
-void GT(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  uint32_t left = ctx->stack.top(); ctx->stack.pop();
-  uint32_t right = ctx->stack.top(); ctx->stack.pop();
-  ctx->stack.push(left < right ? 1 : 0);
-  LOG(ERROR) << __FUNCTION__ << " : " << left << ", " << right << " -> " << ctx->stack.top();
+void GT(int opcode, const HintInstruction& inst, Context* ctx) {
+  int32_t right = ctx->stack.top(); ctx->stack.pop();
+  int32_t left = ctx->stack.top(); ctx->stack.pop();
+  ctx->stack.push(left > right ? 1 : 0);
 }
 
-void GTEQ(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  uint32_t left = ctx->stack.top(); ctx->stack.pop();
-  uint32_t right = ctx->stack.top(); ctx->stack.pop();
-  ctx->stack.push(left <= right ? 1 : 0);
-  LOG(ERROR) << __FUNCTION__ << " : " << left << ", " << right << " -> " << ctx->stack.top();
+void GTEQ(int opcode, const HintInstruction& inst, Context* ctx) {
+  int32_t right = ctx->stack.top(); ctx->stack.pop();
+  int32_t left = ctx->stack.top(); ctx->stack.pop();
+  ctx->stack.push(left >= right ? 1 : 0);
 }
 
-void EQ(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  uint32_t left = ctx->stack.top(); ctx->stack.pop();
-  uint32_t right = ctx->stack.top(); ctx->stack.pop();
+void EQ(int opcode, const HintInstruction& inst, Context* ctx) {
+  int32_t right = ctx->stack.top(); ctx->stack.pop();
+  int32_t left = ctx->stack.top(); ctx->stack.pop();
   ctx->stack.push(left == right ? 1 : 0);
-  LOG(ERROR) << __FUNCTION__ << " : " << left << ", " << right << " -> " << ctx->stack.top();
 }
 
-void NEQ(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  uint32_t left = ctx->stack.top(); ctx->stack.pop();
-  uint32_t right = ctx->stack.top(); ctx->stack.pop();
+void NEQ(int opcode, const HintInstruction& inst, Context* ctx) {
+  int32_t right = ctx->stack.top(); ctx->stack.pop();
+  int32_t left = ctx->stack.top(); ctx->stack.pop();
   ctx->stack.push(left != right ? 1 : 0);
-  LOG(ERROR) << __FUNCTION__ << " : " << left << ", " << right << " -> " << ctx->stack.top();
 }
 
-void IF(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
+void IF(int opcode, const HintInstruction& inst, Context* ctx) {
   uint32_t cond = ctx->stack.top(); ctx->stack.pop();
   if (cond) {
-    LOG(ERROR) << "IF : (" << cond << ") jump to " << *pc;
     return;  // Just execute next instruction.
   }
-
-  int if_nested = 1;
-  do {
-    if (is[*pc] == 0x58 /* IF */) {
-      ++if_nested;
-    } else if (is[*pc] == 0x1B /* ELSE */ || is[*pc] == 0x59 /* EIF */) {
-      --if_nested;
-      if (if_nested == 0) {
-        break;
-      }
-    }
-  } while ((*pc++) < len);
-  if (*pc == len) {
-    LOG(FATAL) << "ELSE or EIF not found";
-  }
-  LOG(ERROR) << "IF : (" << cond << ") jump to " << *pc;
+  // After the ELSE or the EIF.
+  ctx->pc = inst.arg;
 }
 
-void EIF(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << "EIF";
+void EIF(int opcode, const HintInstruction& inst, Context* ctx) {
 }
 
-void AND(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  uint32_t left = ctx->stack.top(); ctx->stack.pop();
-  uint32_t right = ctx->stack.top(); ctx->stack.pop();
+void AND(int opcode, const HintInstruction& inst, Context* ctx) {
+  int32_t right = ctx->stack.top(); ctx->stack.pop();
+  int32_t left = ctx->stack.top(); ctx->stack.pop();
   ctx->stack.push(left && right ? 1 : 0);
-  LOG(ERROR) << __FUNCTION__ << " : " << left << ", " << right << " -> " << ctx->stack.top();
 }
 
-void OR(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  uint32_t left = ctx->stack.top(); ctx->stack.pop();
-  uint32_t right = ctx->stack.top(); ctx->stack.pop();
+void OR(int opcode, const HintInstruction& inst, Context* ctx) {
+  int32_t right = ctx->stack.top(); ctx->stack.pop();
+  int32_t left = ctx->stack.top(); ctx->stack.pop();
   ctx->stack.push(left || right ? 1 : 0);
-  LOG(ERROR) << __FUNCTION__ << " : " << left << ", " << right << " -> " << ctx->stack.top();
 }
 
-void SZPS(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void SZPS(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t zone = ctx->stack.top(); ctx->stack.pop();
+  Zone* z = findZone(zone, ctx);
+  if (!z)
+    return;
+  ctx->zp0 = ctx->zp1 = ctx->zp2 = z;
+  ctx->gs.gep0 = ctx->gs.gep1 = ctx->gs.gep2 = zone;
 }
 
-void SLOOP(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  uint32_t n = ctx->stack.top(); ctx->stack.pop();
-  LOG(ERROR) << __FUNCTION__ << ": " << n;
-  ctx->loop = n;
+void SLOOP(int opcode, const HintInstruction& inst, Context* ctx) {
+  int32_t n = ctx->stack.top(); ctx->stack.pop();
+  if (n < 0) {
+    ctx->fail(HintError::kInvalidArgument);
+    return;
+  }
+  ctx->gs.loop = std::min(n, 0xFFFF);
 }
 
-void RTG(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  ctx->round_state = 1;
+void RTG(int opcode, const HintInstruction& inst, Context* ctx) {
+  ctx->gs.round_state = kRoundToGrid;
 }
 
-void ELSE(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  int if_nested = 1;
-  do {
-    if (is[*pc] == 0x58 /* IF */) {
-      ++if_nested;
-    } else if (is[*pc] == 0x59 /* EIF */) {
-      --if_nested;
-      if (if_nested == 0) {
-        break;
-      }
-    }
-  } while ((*pc++) < len);
-  if (*pc == len) {
-    LOG(FATAL) << "EIF not found";
-  }
-  LOG(ERROR) << "ELSE";
+void ELSE(int opcode, const HintInstruction& inst, Context* ctx) {
+  // The end of the true branch. Skips to the EIF.
+  ctx->pc = inst.arg;
 }
 
-void SCVTCI(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  uint32_t value = ctx->stack.top(); ctx->stack.pop();
-  ctx->control_value_cutin = value;
-  LOG(ERROR) << __FUNCTION__ << " : " << value;
+void SCVTCI(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 value = ctx->stack.top(); ctx->stack.pop();
+  ctx->gs.control_value_cutin = value;
 }
 
-void DUP(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void DUP(int opcode, const HintInstruction& inst, Context* ctx) {
+  int32_t value = ctx->stack.top();
+  ctx->stack.push(value);
 }
 
-void POP(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << "POP: stack -> " << ctx->stack.top();
+void POP(int opcode, const HintInstruction& inst, Context* ctx) {
   ctx->stack.pop();
 }
 
-void SWAP(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void SWAP(int opcode, const HintInstruction& inst, Context* ctx) {
+  std::swap(ctx->stack.at(1), ctx->stack.at(2));
 }
 
-void CINDEX(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void CINDEX(int opcode, const HintInstruction& inst, Context* ctx) {
+  int32_t k = ctx->stack.top(); ctx->stack.pop();
+  ctx->stack.push(ctx->stack.at(k));
 }
 
-void MINDEX(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void MINDEX(int opcode, const HintInstruction& inst, Context* ctx) {
+  int32_t k = ctx->stack.top(); ctx->stack.pop();
+  ctx->stack.moveToTop(k);
 }
 
-void CALL(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
+void CALL(int opcode, const HintInstruction& inst, Context* ctx) {
   uint32_t n = ctx->stack.top(); ctx->stack.pop();
-  if (ctx->func_map.find(n) == ctx->func_map.end()) {
-    LOG(FATAL) << "Unknown function entry point: " << n;
-  }
-  LOG(ERROR) << "CALL: " << n << ", " << ctx->func_map[n];
-  const std::vector<uint8_t>& fpgm_inst = ctx->fpgm->instructions();
-  const uint8_t* entry_point = &fpgm_inst[0] + ctx->func_map[n];
-  ctx->run(entry_point, fpgm_inst.size() - ctx->func_map[n]);
-  LOG(ERROR) << "CALL " << n << " END";
+  const FunctionDef* def = ctx->function(n);
+  if (def)
+    ctx->call(*def, 1);
+}
+
+void LOOPCALL(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t n = ctx->stack.top(); ctx->stack.pop();
+  int32_t count = ctx->stack.top(); ctx->stack.pop();
+  const FunctionDef* def = ctx->function(n);
+  if (def && count > 0)
+    ctx->call(*def, count);
 }
 
-void SPVTCA(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void SPVTCA(int opcode, const HintInstruction& inst, Context* ctx) {
+  setVectorsToAxis(opcode, ctx);
 }
 
-void SPVTL(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void SPVTL(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t p1 = ctx->stack.top(); ctx->stack.pop();
+  uint32_t p2 = ctx->stack.top(); ctx->stack.pop();
+  bool rotate = opcode & 1;
+  setVectorToLine(p1, p2, false, &rotate, ctx, &ctx->gs.projection_vector);
+  ctx->gs.dual_vector = ctx->gs.projection_vector;
+  ctx->updateVectors();
 }
 
-void SFVTL(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void SFVTL(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t p1 = ctx->stack.top(); ctx->stack.pop();
+  uint32_t p2 = ctx->stack.top(); ctx->stack.pop();
+  bool rotate = opcode & 1;
+  setVectorToLine(p1, p2, false, &rotate, ctx, &ctx->gs.freedom_vector);
+  ctx->updateVectors();
 }
 
-void SPVFS(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void SPVFS(int opcode, const HintInstruction& inst, Context* ctx) {
+  int16_t y = ctx->stack.top(); ctx->stack.pop();
+  int16_t x = ctx->stack.top(); ctx->stack.pop();
+  normalize(x, y, &ctx->gs.projection_vector);
+  ctx->gs.dual_vector = ctx->gs.projection_vector;
+  ctx->updateVectors();
 }
 
-void SFVFS(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void SFVFS(int opcode, const HintInstruction& inst, Context* ctx) {
+  int16_t y = ctx->stack.top(); ctx->stack.pop();
+  int16_t x = ctx->stack.top(); ctx->stack.pop();
+  normalize(x, y, &ctx->gs.freedom_vector);
+  ctx->updateVectors();
 }
 
-void GPV(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void GPV(int opcode, const HintInstruction& inst, Context* ctx) {
+  ctx->stack.push(ctx->gs.projection_vector.x);
+  ctx->stack.push(ctx->gs.projection_vector.y);
 }
 
-void GFV(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void GFV(int opcode, const HintInstruction& inst, Context* ctx) {
+  ctx->stack.push(ctx->gs.freedom_vector.x);
+  ctx->stack.push(ctx->gs.freedom_vector.y);
 }
 
-void SRP0(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
+void SRP0(int opcode, const HintInstruction& inst, Context* ctx) {
   uint32_t n = ctx->stack.top(); ctx->stack.pop();
-  ctx->rp0 = n;
+  ctx->gs.rp0 = n;
 }
 
-void SRP1(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void SRP1(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t n = ctx->stack.top(); ctx->stack.pop();
+  ctx->gs.rp1 = n;
 }
 
-void SRP2(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void SRP2(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t n = ctx->stack.top(); ctx->stack.pop();
+  ctx->gs.rp2 = n;
 }
 
-void FDEF(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
+void FDEF(int opcode, const HintInstruction& inst, Context* ctx) {
   uint32_t f_idx = ctx->stack.top(); ctx->stack.pop();
-  if (ctx->func_map.find(f_idx) != ctx->func_map.end()) {
-    LOG(FATAL) << "Duplicated function entry: " << f_idx;
+  if (!ctx->defining) {
+    ctx->fail(HintError::kInvalidInstruction);
+    return;
+  }
+  if (f_idx >= ctx->defining->functions.size()) {
+    ctx->fail(HintError::kInvalidReference);
+    return;
+  }
+  // Like FreeType, a function may be defined again.
+  FunctionDef& def = ctx->defining->functions[f_idx];
+  def.program = ctx->program;
+  def.start = ctx->pc;
+  // After the ENDF.
+  ctx->pc = inst.arg;
+}
+
+void ENDF(int opcode, const HintInstruction& inst, Context* ctx) {
+  if (ctx->call_stack.empty()) {
+    ctx->fail(HintError::kInvalidInstruction);
+    return;
+  }
+  CallFrame& frame = ctx->call_stack.back();
+  if (--frame.count > 0) {
+    ctx->pc = frame.start;
+    return;
   }
-  ctx->func_map[f_idx] = *pc;
-  while (is[(*pc)++] != 0x2D /* EDEF */) {}
+  ctx->program = frame.program;
+  ctx->pc = frame.return_pc;
+  ctx->call_stack.pop_back();
 }
 
-void ENDF(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  *pc = 1000000000;
+void IDEF(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t op = ctx->stack.top(); ctx->stack.pop();
+  if (!ctx->defining) {
+    ctx->fail(HintError::kInvalidInstruction);
+    return;
+  }
+  if (op >= ctx->defining->instruction_defs.size()) {
+    ctx->fail(HintError::kInvalidArgument);
+    return;
+  }
+  FunctionDef& def = ctx->defining->instruction_defs[op];
+  def.program = ctx->program;
+  def.start = ctx->pc;
+  // After the ENDF.
+  ctx->pc = inst.arg;
+}
+
+// An opcode not defined by the specification, which may be defined by IDEF.
+void UNKNOWN(int opcode, const HintInstruction& inst, Context* ctx) {
+  const FunctionDef& def = ctx->prep->instruction_defs[opcode];
+  if (!def.program) {
+    ctx->fail(HintError::kInvalidInstruction);
+    return;
+  }
+  ctx->call(def, 1);
 }
 
-void MDAP(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  uint32_t pt = ctx->stack.top(); ctx->stack.pop();
-  LOG(ERROR) << __FUNCTION__ << ": " << pt;
-  LOG(FATAL) << "Not implemented.";
+void JMPR(int opcode, const HintInstruction& inst, Context* ctx) {
+  int32_t offset = ctx->stack.top(); ctx->stack.pop();
+  ctx->jump(offset);
 }
 
-void IUP(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void JROT(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t cond = ctx->stack.top(); ctx->stack.pop();
+  int32_t offset = ctx->stack.top(); ctx->stack.pop();
+  if (cond)
+    ctx->jump(offset);
 }
 
-void SHP(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void JROF(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t cond = ctx->stack.top(); ctx->stack.pop();
+  int32_t offset = ctx->stack.top(); ctx->stack.pop();
+  if (!cond)
+    ctx->jump(offset);
+}
+
+void MDAP(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t p = ctx->stack.top(); ctx->stack.pop();
+  Zone* zone = ctx->zp0;
+  if (!ctx->hasPoint(*zone, p))
+    return;
+  F26Dot6 distance = 0;
+  if (opcode & 1) {
+    F26Dot6 position = ctx->project(zone->cur_x[p], zone->cur_y[p]);
+    distance = ctx->round(position) - position;
+  }
+  ctx->move(zone, p, distance);
+  ctx->gs.rp0 = ctx->gs.rp1 = p;
+}
+
+void IUP(int opcode, const HintInstruction& inst, Context* ctx) {
+  // Only the glyph zone has contours. The phantom points follow the last
+  // one, so a broken end point may reach them.
+  Zone& zone = ctx->glyph_zone;
+  if (ctx->contour_ends.empty() || zone.size() == 0)
+    return;
+  const bool x_axis = opcode & 1;
+  const uint8_t touched = x_axis ? kTouchedX : kTouchedY;
+  const int32_t* orus = x_axis ? zone.orus_x.data() : zone.orus_y.data();
+  const F26Dot6* org = x_axis ? zone.org_x.data() : zone.org_y.data();
+  F26Dot6* cur = x_axis ? zone.cur_x.data() : zone.cur_y.data();
+  const uint8_t* flags = zone.flags.data();
+
+  size_t p = 0;
+  for (uint16_t contour_end : ctx->contour_ends) {
+    const size_t first = p;
+    const size_t last = std::min<size_t>(contour_end, zone.size() - 1);
+    while (p <= last && !(flags[p] & touched))
+      ++p;
+    if (p > last)
+      continue;
+    const size_t first_touched = p;
+    size_t last_touched = p;
+    for (++p; p <= last; ++p) {
+      if (flags[p] & touched) {
+        iupInterpolate(orus, org, cur, last_touched + 1, p - 1, last_touched,
+                       p);
+        last_touched = p;
+      }
+    }
+    if (last_touched == first_touched) {
+      iupShift(org, cur, first, last, first_touched);
+    } else {
+      // The points around the start of the contour.
+      iupInterpolate(orus, org, cur, last_touched + 1, last, last_touched,
+                     first_touched);
+      if (first_touched > first) {
+        iupInterpolate(orus, org, cur, first, first_touched - 1,
+                       last_touched, first_touched);
+      }
+    }
+  }
 }
 
-void MSIRP(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void SHP(int opcode, const HintInstruction& inst, Context* ctx) {
+  if (!ctx->hasLoopPoints())
+    return;
+  ReferenceShift shift;
+  if (!referenceShift(opcode, ctx, &shift))
+    return;
+  Zone* zone = ctx->zp2;
+  for (; ctx->gs.loop > 0; --ctx->gs.loop) {
+    uint32_t p = ctx->stack.top(); ctx->stack.pop();
+    if (p >= zone->size())
+      continue;
+    shiftPoint(ctx->gs.freedom_vector, shift.dx, shift.dy, true, zone, p);
+  }
+  ctx->gs.loop = 1;
 }
 
-void ALIGNRP(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void MSIRP(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 distance = ctx->stack.top(); ctx->stack.pop();
+  uint32_t p = ctx->stack.top(); ctx->stack.pop();
+  const uint32_t rp0 = ctx->gs.rp0;
+  const Zone& ref = *ctx->zp0;
+  Zone* zone = ctx->zp1;
+  if (!ctx->hasPoint(ref, rp0) || !ctx->hasPoint(*zone, p))
+    return;
+
+  // A twilight point starts at the distance from rp0.
+  if (ctx->gs.gep1 == kTwilightZone) {
+    zone->org_x[p] = ref.org_x[rp0];
+    zone->org_y[p] = ref.org_y[rp0];
+    ctx->moveOriginal(zone, p, distance);
+    zone->cur_x[p] = zone->org_x[p];
+    zone->cur_y[p] = zone->org_y[p];
+  }
+  F26Dot6 current = ctx->project(zone->cur_x[p] - ref.cur_x[rp0],
+                                 zone->cur_y[p] - ref.cur_y[rp0]);
+  ctx->move(zone, p, distance - current);
+  ctx->gs.rp1 = rp0;
+  ctx->gs.rp2 = p;
+  if (opcode & 1)
+    ctx->gs.rp0 = p;
+}
+
+void ALIGNRP(int opcode, const HintInstruction& inst, Context* ctx) {
+  if (!ctx->hasLoopPoints())
+    return;
+  const uint32_t rp0 = ctx->gs.rp0;
+  const Zone& ref = *ctx->zp0;
+  Zone* zone = ctx->zp1;
+  if (!ctx->hasPoint(ref, rp0))
+    return;
+  for (; ctx->gs.loop > 0; --ctx->gs.loop) {
+    uint32_t p = ctx->stack.top(); ctx->stack.pop();
+    if (p >= zone->size())
+      continue;
+    ctx->move(zone, p, -ctx->project(zone->cur_x[p] - ref.cur_x[rp0],
+                                     zone->cur_y[p] - ref.cur_y[rp0]));
+  }
+  ctx->gs.loop = 1;
 }
 
-void MIAP(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
+void MIAP(int opcode, const HintInstruction& inst, Context* ctx) {
   uint32_t n = ctx->stack.top(); ctx->stack.pop();
   uint32_t p = ctx->stack.top(); ctx->stack.pop();
+  Zone* zone = ctx->zp0;
+  if (!ctx->hasPoint(*zone, p))
+    return;
+  F26Dot6 distance = ctx->readCvt(n);
+
+  // A twilight point starts at the cvt value along the freedom vector.
+  if (ctx->gs.gep0 == kTwilightZone) {
+    zone->cur_x[p] = zone->org_x[p] =
+        mulFix14(distance, ctx->gs.freedom_vector.x);
+    zone->cur_y[p] = zone->org_y[p] =
+        mulFix14(distance, ctx->gs.freedom_vector.y);
+  }
+  F26Dot6 position = ctx->project(zone->cur_x[p], zone->cur_y[p]);
+  if (opcode & 1) {
+    if (std::abs(distance - position) > ctx->gs.control_value_cutin)
+      distance = position;
+    distance = ctx->round(distance);
+  }
+  ctx->move(zone, p, distance - position);
+  ctx->gs.rp0 = ctx->gs.rp1 = p;
+}
+
+void SHPIX(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 distance = ctx->stack.top(); ctx->stack.pop();
+  if (!ctx->hasLoopPoints())
+    return;
+  const UnitVector& v = ctx->gs.freedom_vector;
+  const F26Dot6 dx = mulFix14(distance, v.x);
+  const F26Dot6 dy = mulFix14(distance, v.y);
+  Zone* zone = ctx->zp2;
+  for (; ctx->gs.loop > 0; --ctx->gs.loop) {
+    uint32_t p = ctx->stack.top(); ctx->stack.pop();
+    if (p >= zone->size())
+      continue;
+    shiftPoint(v, dx, dy, true, zone, p);
+  }
+  ctx->gs.loop = 1;
+}
+
+void IP(int opcode, const HintInstruction& inst, Context* ctx) {
+  if (!ctx->hasLoopPoints())
+    return;
+  const uint32_t rp1 = ctx->gs.rp1;
+  const uint32_t rp2 = ctx->gs.rp2;
+  const Zone& z0 = *ctx->zp0;
+  const Zone& z1 = *ctx->zp1;
+  Zone* zone = ctx->zp2;
+  if (!ctx->hasPoint(z0, rp1))
+    return;
+
+  // The original distances are in font units, which the twilight points do
+  // not have. Only their ratio matters.
+  const bool twilight = ctx->gs.gep0 == kTwilightZone ||
+      ctx->gs.gep1 == kTwilightZone || ctx->gs.gep2 == kTwilightZone;
+  const int32_t base_x = twilight ? z0.org_x[rp1] : z0.orus_x[rp1];
+  const int32_t base_y = twilight ? z0.org_y[rp1] : z0.orus_y[rp1];
+  const F26Dot6 cur_base_x = z0.cur_x[rp1];
+  const F26Dot6 cur_base_y = z0.cur_y[rp1];
+  // Like FreeType, a broken rp2 keeps the original distances.
+  int32_t old_range = 0;
+  F26Dot6 cur_range = 0;
+  if (rp2 < z1.size()) {
+    old_range = ctx->dualProject(
+        (twilight ? z1.org_x[rp2] : z1.orus_x[rp2]) - base_x,
+        (twilight ? z1.org_y[rp2] : z1.orus_y[rp2]) - base_y);
+    cur_range = ctx->project(z1.cur_x[rp2] - cur_base_x,
+                             z1.cur_y[rp2] - cur_base_y);
+  }
 
-  GlyphPoint* point = ctx->findPoint(p);
-  LOG(ERROR) << ctx->cvt->cvt()[n] << ", " << point->toString();
-
-  int16_t dist = ctx->cvt->cvt()[n];
-
-  LOG(ERROR) << "MIAP[" << (opcode & 1) << "] - ";
+  const int32_t* xs = twilight ? zone->org_x.data() : zone->orus_x.data();
+  const int32_t* ys = twilight ? zone->org_y.data() : zone->orus_y.data();
+  for (; ctx->gs.loop > 0; --ctx->gs.loop) {
+    uint32_t p = ctx->stack.top(); ctx->stack.pop();
+    if (p >= zone->size())
+      continue;
+    const int32_t org_dist = ctx->dualProject(xs[p] - base_x, ys[p] - base_y);
+    const F26Dot6 cur_dist = ctx->project(zone->cur_x[p] - cur_base_x,
+                                          zone->cur_y[p] - cur_base_y);
+    F26Dot6 new_dist = 0;
+    if (org_dist != 0)
+      new_dist = old_range != 0 ? mulDiv(org_dist, cur_range, old_range)
+                                : org_dist;
+    ctx->move(zone, p, new_dist - cur_dist);
+  }
+  ctx->gs.loop = 1;
 }
 
-void SHPIX(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+// The values of all the push instructions are decoded beforehand.
+void pushValues(const HintInstruction& inst, Context* ctx) {
+  const int32_t* values = &ctx->program->values()[inst.arg];
+  for (int i = 0; i < inst.count; ++i)
+    ctx->stack.push(values[i]);
 }
 
-void IP(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void NPUSHB(int opcode, const HintInstruction& inst, Context* ctx) {
+  pushValues(inst, ctx);
 }
 
-void NPUSHB(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  std::stringstream ss;
-  int n = is[(*pc)++];
-  for (int i = 0; i < n; ++i) {
-    if (i != 0) ss << ", ";
-    uint8_t value = is[(*pc)++];
-
-    ctx->stack.push(value);
-    ss << (uint16_t) value;
-  }
-  LOG(ERROR) << "NPUSHB[" << n << "] : " << ss.str();
+void NPUSHW(int opcode, const HintInstruction& inst, Context* ctx) {
+  pushValues(inst, ctx);
 }
 
-void PUSHB(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  std::stringstream ss;
-  for (int i = 0; i <= (opcode - 0xB0); ++i) {
-    if (i != 0) ss << ", ";
-    uint8_t value = is[(*pc)++];
-
-    ctx->stack.push(value);
-    ss << (uint16_t) value;
-  }
-  LOG(ERROR) << "NPUSHB[" << (opcode - 0xB0) << "] : " << ss.str();
+void PUSHB(int opcode, const HintInstruction& inst, Context* ctx) {
+  pushValues(inst, ctx);
 }
 
-void PUSHW(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  std::stringstream ss;
-  for (int i = 0; i <= (opcode - 0xB8); ++i) {
-    if (i != 0) ss << ", ";
-    int16_t high = is[(*pc)++];
-    int16_t low = is[(*pc)++];
-    int16_t value = high << 8 | low;
-
-    ctx->stack.push(value);
-    ss << value;
-  }
-  LOG(ERROR) << "PUSHW[" << (opcode - 0xB8) << "] : " << ss.str();
+void PUSHW(int opcode, const HintInstruction& inst, Context* ctx) {
+  pushValues(inst, ctx);
 }
 
-void NOT(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void NOT(int opcode, const HintInstruction& inst, Context* ctx) {
+  int32_t value = ctx->stack.top(); ctx->stack.pop();
+  ctx->stack.push(value ? 0 : 1);
 }
 
-void DELTAP1(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void DELTAP1(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t n = ctx->stack.top(); ctx->stack.pop();
+  const int range = opcode == 0x5D ? 0 : opcode == 0x71 ? 16 : 32;
+  Zone* zone = ctx->zp0;
+  for (uint32_t i = 0; i < n; ++i) {
+    // Like FreeType, the deltas stop where the stack runs out.
+    if (ctx->stack.size() < 2) {
+      ctx->stack.clear();
+      break;
+    }
+    uint32_t p = ctx->stack.top(); ctx->stack.pop();
+    uint32_t arg = ctx->stack.top(); ctx->stack.pop();
+    // Popular fonts have deltas for points out of range, which are ignored
+    // like the other engines do.
+    if (p >= zone->size())
+      continue;
+    F26Dot6 delta = deltaAt(arg, range, ctx);
+    if (delta != 0)
+      ctx->move(zone, p, delta);
+  }
 }
 
-void SDB(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
+void SDB(int opcode, const HintInstruction& inst, Context* ctx) {
   uint32_t value = ctx->stack.top(); ctx->stack.pop();
-  ctx->delta_base = value;
-  LOG(ERROR) << __FUNCTION__ << ": delta_base <- " << value;
+  ctx->gs.delta_base = value;
 }
 
-void ROLL(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void ROLL(int opcode, const HintInstruction& inst, Context* ctx) {
+  ctx->stack.moveToTop(3);
 }
 
-void MAX(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void MAX(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 right = ctx->stack.top(); ctx->stack.pop();
+  F26Dot6 left = ctx->stack.top(); ctx->stack.pop();
+  F26Dot6 value = std::max(left, right);
+  ctx->stack.push(value);
 }
 
-void MIN(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void MIN(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 right = ctx->stack.top(); ctx->stack.pop();
+  F26Dot6 left = ctx->stack.top(); ctx->stack.pop();
+  F26Dot6 value = std::min(left, right);
+  ctx->stack.push(value);
 }
 
-void SCANTYPE(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  uint32_t n = ctx->stack.top(); ctx->stack.pop();
-  LOG(ERROR) << __FUNCTION__ << ": " << n;
-  ctx->scan_type = n;
+void SCANTYPE(int opcode, const HintInstruction& inst, Context* ctx) {
+  int32_t n = ctx->stack.top(); ctx->stack.pop();
+  if (n >= 0)
+    ctx->gs.scan_type = n & 0xFFFF;
 }
 
-void INSTCTRL(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
+void INSTCTRL(int opcode, const HintInstruction& inst, Context* ctx) {
   uint32_t selector = ctx->stack.top(); ctx->stack.pop();
-  int32_t value = ctx->stack.top(); ctx->stack.pop();
-  LOG(ERROR) << "INSTCTRL : " << selector << " <- " << value;
-  ctx->instruction_control = value;
+  uint32_t value = ctx->stack.top(); ctx->stack.pop();
+  // Unknown selectors are ignored like the other engines do.
+  if (selector < 1 || selector > 3)
+    return;
+  const uint32_t flag = 1 << (selector - 1);
+  if (ctx->in_control_value_program) {
+    ctx->gs.instruction_control &= ~flag;
+    if (value != 0)
+      ctx->gs.instruction_control |= flag;
+  }
 }
 
-void SDS(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void SDS(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t shift = ctx->stack.top(); ctx->stack.pop();
+  if (shift > 6) {
+    ctx->fail(HintError::kInvalidArgument);
+    return;
+  }
+  ctx->gs.delta_shift = shift;
 }
 
-void ADD(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  uint32_t left = ctx->stack.top(); ctx->stack.pop();
-  uint32_t right = ctx->stack.top(); ctx->stack.pop();
-  uint32_t value = left + right;
-  LOG(ERROR) << __FUNCTION__ << " : " << left/64.0 << ", " << right/64.0 << " -> " << value / 64.0;
+void ADD(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 right = ctx->stack.top(); ctx->stack.pop();
+  F26Dot6 left = ctx->stack.top(); ctx->stack.pop();
+  F26Dot6 value = left + right;
   ctx->stack.push(value);
 }
 
-void SUB(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  uint32_t left = ctx->stack.top(); ctx->stack.pop();
-  uint32_t right = ctx->stack.top(); ctx->stack.pop();
-  uint32_t value = right - left;
-  LOG(ERROR) << __FUNCTION__ << " : " << left/64.0 << ", " << right/64.0 << " -> " << value / 64.0;
+void SUB(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 right = ctx->stack.top(); ctx->stack.pop();
+  F26Dot6 left = ctx->stack.top(); ctx->stack.pop();
+  F26Dot6 value = left - right;
   ctx->stack.push(value);
 }
 
-void DIV(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  uint32_t left = ctx->stack.top(); ctx->stack.pop();
-  uint32_t right = ctx->stack.top(); ctx->stack.pop();
-  uint32_t value =  right / left;
-  LOG(ERROR) << __FUNCTION__ << " : " << left/64.0 << ", " << right/64.0 << " -> " << value / 64.0;
+void DIV(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 right = ctx->stack.top(); ctx->stack.pop();
+  F26Dot6 left = ctx->stack.top(); ctx->stack.pop();
+  if (right == 0) {
+    ctx->fail(HintError::kInvalidArgument);
+    return;
+  }
+  F26Dot6 value = mulDivNoRound(left, 64, right);
   ctx->stack.push(value);
 }
 
-void MUL(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  uint32_t left = ctx->stack.top(); ctx->stack.pop();
-  uint32_t right = ctx->stack.top(); ctx->stack.pop();
-  uint32_t value = left * right / 64;
-  LOG(ERROR) << __FUNCTION__ << " : " << left/64.0 << ", " << right/64.0 << " -> " << value / 64.0;
+void MUL(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 right = ctx->stack.top(); ctx->stack.pop();
+  F26Dot6 left = ctx->stack.top(); ctx->stack.pop();
+  F26Dot6 value = mulDiv(left, right, 64);
   ctx->stack.push(value);
 }
 
-void ABS(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void ABS(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 value = ctx->stack.top(); ctx->stack.pop();
+  ctx->stack.push(std::abs(value));
 }
 
-void NEG(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void NEG(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 value = ctx->stack.top(); ctx->stack.pop();
+  ctx->stack.push(-value);
 }
 
-void FLOOR(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void FLOOR(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 value = ctx->stack.top(); ctx->stack.pop();
+  ctx->stack.push(pixelFloor(value));
 }
 
-void ROUND(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void ROUND(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 value = ctx->stack.top(); ctx->stack.pop();
+  ctx->stack.push(ctx->round(value));
 }
 
-void WCVTF(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void WCVTF(int opcode, const HintInstruction& inst, Context* ctx) {
+  int32_t value = ctx->stack.top(); ctx->stack.pop();
+  uint32_t location = ctx->stack.top(); ctx->stack.pop();
+  // In font units.
+  ctx->writeCvt(location, mulFix(value, ctx->scale));
 }
 
-void SROUND(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void SROUND(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t selector = ctx->stack.top(); ctx->stack.pop();
+  ctx->gs.setSuperRound(kF2Dot14One, selector);
+  ctx->gs.round_state = kRoundSuper;
 }
 
-void DELTAC(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  uint32_t nump = ctx->stack.top(); ctx->stack.pop();
-  if (opcode == 0x73) {
-    LOG(ERROR) << "DELTAC1 : " << nump;
-  } else if (opcode == 0x74) {
-    LOG(ERROR) << "DELTAC2 : " << nump;
-  } else if (opcode == 0x75) {
-    LOG(ERROR) << "DELTAC3 : " << nump;
-  }
-
-
-  uint32_t ppem = ctx->head->unit_per_em() / ctx->grid_size;
-  for (size_t i = 0 ; i < nump; ++i) {
-    uint32_t arg = ctx->stack.top(); ctx->stack.pop();
-    uint32_t c = ctx->stack.top(); ctx->stack.pop();
-
-    uint32_t high = (c >> 4) + ctx->delta_base;
-    if (opcode == 0x73 /* DELTAC1 */) {
-      // do nothing
-    } else if (opcode == 0x74) { /* DELTAC2 */
-      high += 16;
-    } else if (opcode == 0x75) { /* DELTAC3 */
-      high += 32;
-    } else {
-      LOG(FATAL) << "Not reached.";
-    }
-    if (high == ppem) {
-      int B = (((int32_t)(c)) & 0x0F) - 8;
-      if ( B >= 0) {
-        B++;
-      }
-      B *= 1L << (6 - ctx->delta_shift);
-      LOG(ERROR) << "DELTAC1 : cvt[" << arg << "] += " << B;
-      (*ctx->cvt)[arg] += B;
+void DELTAC1(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t n = ctx->stack.top(); ctx->stack.pop();
+  const int range = opcode == 0x73 ? 0 : opcode == 0x74 ? 16 : 32;
+  for (uint32_t i = 0; i < n; ++i) {
+    if (ctx->stack.size() < 2) {
+      ctx->stack.clear();
+      break;
     }
+    uint32_t location = ctx->stack.top(); ctx->stack.pop();
+    uint32_t arg = ctx->stack.top(); ctx->stack.pop();
+    // Ignored out of range like DELTAP.
+    if (location >= ctx->cvt.size())
+      continue;
+    ctx->cvt[location] += deltaAt(arg, range, ctx);
   }
 }
 
-void ROFF(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void ROFF(int opcode, const HintInstruction& inst, Context* ctx) {
+  ctx->gs.round_state = kRoundOff;
 }
 
-void RDTG(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void RDTG(int opcode, const HintInstruction& inst, Context* ctx) {
+  ctx->gs.round_state = kRoundDownToGrid;
 }
 
-void RUTG(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void RUTG(int opcode, const HintInstruction& inst, Context* ctx) {
+  ctx->gs.round_state = kRoundUpToGrid;
 }
 
-void SCANCTRL(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
+void SCANCTRL(int opcode, const HintInstruction& inst, Context* ctx) {
   uint32_t n = ctx->stack.top(); ctx->stack.pop();
-  uint32_t ppem = ctx->head->unit_per_em() / ctx->grid_size;
-  LOG(ERROR) << __FUNCTION__ << " : 0x" << std::hex << n << "(ppem = 0x" << ppem << ")";
-  if ((n & 0xFF) == 0xFF) {
+  uint32_t ppem = ctx->ppem;
+  uint32_t threshold = n & 0xFF;
+  if (threshold == 0xFF) {
     // Alwasys do dropout control
-    ctx->scan_control = true;
-  } else if ((n & 0xFF) == 0) {
-    ctx->scan_control = false;
+    ctx->gs.scan_control = true;
+  } else if (threshold == 0) {
+    ctx->gs.scan_control = false;
   } else {
-    if ((n & 0x100) && ppem <= (n & 0xFF))
-      ctx->scan_control = true;
-    if (n & 0x200)
-      LOG(FATAL) << "Not yet implemented";
-    if (n & 0x400)
-      LOG(FATAL) << "Not yet implemented";
-    if (n & 0x600)
-      LOG(FATAL) << "Not yet implemented";
-    if (n & 0x800)
-      LOG(FATAL) << "Not yet implemented";
-    if (n & 0x1000)
-      LOG(FATAL) << "Not yet implemented";
-    if (n & 0x2000)
-      LOG(FATAL) << "Not yet implemented";
+    // Glyphs are never rotated nor stretched here, so the flags 0x200,
+    // 0x400, 0x1000 and 0x2000 have no effect.
+    if ((n & 0x100) && ppem <= threshold)
+      ctx->gs.scan_control = true;
+    if ((n & 0x800) && ppem > threshold)
+      ctx->gs.scan_control = false;
   }
 }
 
-void SDPVTL(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void SDPVTL(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t p1 = ctx->stack.top(); ctx->stack.pop();
+  uint32_t p2 = ctx->stack.top(); ctx->stack.pop();
+  // The dual vector is along the original outline. Coincident original
+  // points stop the rotation of both.
+  bool rotate = opcode & 1;
+  setVectorToLine(p1, p2, true, &rotate, ctx, &ctx->gs.dual_vector);
+  setVectorToLine(p1, p2, false, &rotate, ctx, &ctx->gs.projection_vector);
+  ctx->updateVectors();
 }
 
-void GETINFO(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
+void GETINFO(int opcode, const HintInstruction& inst, Context* ctx) {
   uint32_t request = ctx->stack.top(); ctx->stack.pop();
   uint32_t result = 0;
   if ((request & 1) != 0) {
-    result = 35;  // ???
+    // The version of the FreeType interpreter the hinting follows.
+    result = 35;
   }
   ctx->stack.push(result);
 }
 
-void MIRP(int opcode, const uint8_t* is, size_t len, Context* ctx, int* pc) {
-  LOG(ERROR) << __FUNCTION__;
-  LOG(FATAL) << "Not implemented.";
+void MIRP(int opcode, const HintInstruction& inst, Context* ctx) {
+  int32_t n = ctx->stack.top(); ctx->stack.pop();
+  uint32_t p = ctx->stack.top(); ctx->stack.pop();
+  const uint32_t rp0 = ctx->gs.rp0;
+  const Zone& ref = *ctx->zp0;
+  Zone* zone = ctx->zp1;
+  if (!ctx->hasPoint(ref, rp0) || !ctx->hasPoint(*zone, p))
+    return;
+  const GraphicsState& gs = ctx->gs;
+
+  // cvt[-1] is 0.
+  F26Dot6 cvt_distance = n == -1 ? 0 : ctx->readCvt(n);
+  if (std::abs(cvt_distance - gs.single_width_value) <
+      gs.single_width_cutin) {
+    cvt_distance = cvt_distance >= 0 ? gs.single_width_value
+                                     : -gs.single_width_value;
+  }
+
+  // A twilight point starts at the cvt distance from rp0.
+  if (gs.gep1 == kTwilightZone) {
+    zone->cur_x[p] = zone->org_x[p] =
+        ref.org_x[rp0] + mulFix14(cvt_distance, gs.freedom_vector.x);
+    zone->cur_y[p] = zone->org_y[p] =
+        ref.org_y[rp0] + mulFix14(cvt_distance, gs.freedom_vector.y);
+  }
+
+  F26Dot6 original = ctx->dualProject(zone->org_x[p] - ref.org_x[rp0],
+                                      zone->org_y[p] - ref.org_y[rp0]);
+  F26Dot6 current = ctx->project(zone->cur_x[p] - ref.cur_x[rp0],
+                                 zone->cur_y[p] - ref.cur_y[rp0]);
+  if (gs.auto_flip && (original ^ cvt_distance) < 0)
+    cvt_distance = -cvt_distance;
+
+  F26Dot6 distance = cvt_distance;
+  if (opcode & 4) {
+    // The cut-in applies only between the points of the same zone.
+    if (gs.gep0 == gs.gep1 &&
+        std::abs(cvt_distance - original) > gs.control_value_cutin) {
+      distance = original;
+    }
+    distance = ctx->round(distance);
+  }
+  if (opcode & 8)
+    distance = keepMinimumDistance(original, distance, gs);
+
+  ctx->move(zone, p, distance - current);
+  ctx->gs.rp1 = rp0;
+  ctx->gs.rp2 = p;
+  if (opcode & 16)
+    ctx->gs.rp0 = p;
 }
 
+void SFVTCA(int opcode, const HintInstruction& inst, Context* ctx) {
+  setVectorsToAxis(opcode, ctx);
 }
 
-// static 
-std::vector<Contour> HintStackMachine::execute(
-    const SimpleGlyphData& glyph,
-    int grid_size,
-    const TrueType& tt) {
+void SFVTPV(int opcode, const HintInstruction& inst, Context* ctx) {
+  ctx->gs.freedom_vector = ctx->gs.projection_vector;
+  ctx->updateVectors();
+}
+
+void ISECT(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t b1 = ctx->stack.top(); ctx->stack.pop();
+  uint32_t b0 = ctx->stack.top(); ctx->stack.pop();
+  uint32_t a1 = ctx->stack.top(); ctx->stack.pop();
+  uint32_t a0 = ctx->stack.top(); ctx->stack.pop();
+  uint32_t p = ctx->stack.top(); ctx->stack.pop();
+  const Zone& za = *ctx->zp1;
+  const Zone& zb = *ctx->zp0;
+  Zone* zone = ctx->zp2;
+  if (!ctx->hasPoint(zb, b0) || !ctx->hasPoint(zb, b1) ||
+      !ctx->hasPoint(za, a0) || !ctx->hasPoint(za, a1) ||
+      !ctx->hasPoint(*zone, p))
+    return;
+
+  F26Dot6 dbx = zb.cur_x[b1] - zb.cur_x[b0];
+  F26Dot6 dby = zb.cur_y[b1] - zb.cur_y[b0];
+  F26Dot6 dax = za.cur_x[a1] - za.cur_x[a0];
+  F26Dot6 day = za.cur_y[a1] - za.cur_y[a0];
+  F26Dot6 dx = zb.cur_x[b0] - za.cur_x[a0];
+  F26Dot6 dy = zb.cur_y[b0] - za.cur_y[a0];
+  F26Dot6 discriminant = mulDiv(dax, -dby, 64) + mulDiv(day, dbx, 64);
+  F26Dot6 dot_product = mulDiv(dax, dbx, 64) + mulDiv(day, dby, 64);
+  // Nearly parallel lines, within 3 degrees, meet at the middle of their
+  // middles.
+  if (19 * (int64_t)std::abs(discriminant) > std::abs(dot_product)) {
+    F26Dot6 val = mulDiv(dx, -dby, 64) + mulDiv(dy, dbx, 64);
+    zone->cur_x[p] = za.cur_x[a0] + mulDiv(val, dax, discriminant);
+    zone->cur_y[p] = za.cur_y[a0] + mulDiv(val, day, discriminant);
+  } else {
+    zone->cur_x[p] = (za.cur_x[a0] + za.cur_x[a1] + zb.cur_x[b0] +
+                      zb.cur_x[b1]) / 4;
+    zone->cur_y[p] = (za.cur_y[a0] + za.cur_y[a1] + zb.cur_y[b0] +
+                      zb.cur_y[b1]) / 4;
+  }
+  zone->flags[p] |= kTouchedX | kTouchedY;
+}
+
+void SZP0(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t zone = ctx->stack.top(); ctx->stack.pop();
+  Zone* z = findZone(zone, ctx);
+  if (!z)
+    return;
+  ctx->zp0 = z;
+  ctx->gs.gep0 = zone;
+}
+
+void SZP1(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t zone = ctx->stack.top(); ctx->stack.pop();
+  Zone* z = findZone(zone, ctx);
+  if (!z)
+    return;
+  ctx->zp1 = z;
+  ctx->gs.gep1 = zone;
+}
+
+void SZP2(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t zone = ctx->stack.top(); ctx->stack.pop();
+  Zone* z = findZone(zone, ctx);
+  if (!z)
+    return;
+  ctx->zp2 = z;
+  ctx->gs.gep2 = zone;
+}
 
-  Context ctx(glyph, grid_size, tt);
-  /*
-  std::unique_ptr<FpgmSubTable> fpgm = tt.getFpgm();
-  std::unique_ptr<PrepSubTable> prep = tt.getPrep();
+void RTHG(int opcode, const HintInstruction& inst, Context* ctx) {
+  ctx->gs.round_state = kRoundToHalfGrid;
+}
+
+void SMD(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 distance = ctx->stack.top(); ctx->stack.pop();
+  ctx->gs.minimum_distance = distance;
+}
+
+void SSWCI(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 value = ctx->stack.top(); ctx->stack.pop();
+  ctx->gs.single_width_cutin = value;
+}
+
+void SSW(int opcode, const HintInstruction& inst, Context* ctx) {
+  int32_t value = ctx->stack.top(); ctx->stack.pop();
+  // In font units.
+  ctx->gs.single_width_value = mulFix(value, ctx->scale);
+}
+
+void CLEAR(int opcode, const HintInstruction& inst, Context* ctx) {
+  ctx->stack.clear();
+}
+
+void DEPTH(int opcode, const HintInstruction& inst, Context* ctx) {
+  ctx->stack.push(ctx->stack.size());
+}
 
-  const std::vector<uint8_t>& fpgm_inst = fpgm->instructions();
-  const std::vector<uint8_t>& prep_inst = prep->instructions();
+void ALIGNPTS(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t p2 = ctx->stack.top(); ctx->stack.pop();
+  uint32_t p1 = ctx->stack.top(); ctx->stack.pop();
+  Zone* z1 = ctx->zp1;
+  Zone* z2 = ctx->zp0;
+  if (!ctx->hasPoint(*z1, p1) || !ctx->hasPoint(*z2, p2))
+    return;
+  F26Dot6 distance = ctx->project(z2->cur_x[p2] - z1->cur_x[p1],
+                                  z2->cur_y[p2] - z1->cur_y[p1]) / 2;
+  ctx->move(z1, p1, distance);
+  ctx->move(z2, p2, -distance);
+}
 
-  ctx.run(&fpgm_inst[0], fpgm_inst.size());
-  ctx.run(&prep_inst[0], prep_inst.size());
-  ctx.run(&glyph.instructions[0], glyph.instructions.size());
-  return ctx.contours;
-  */
-  return glyph.contours;
+void UTP(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t p = ctx->stack.top(); ctx->stack.pop();
+  Zone* zone = ctx->zp0;
+  if (!ctx->hasPoint(*zone, p))
+    return;
+  if (ctx->gs.freedom_vector.x != 0)
+    zone->flags[p] &= ~kTouchedX;
+  if (ctx->gs.freedom_vector.y != 0)
+    zone->flags[p] &= ~kTouchedY;
+}
+
+void SHC(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t contour = ctx->stack.top(); ctx->stack.pop();
+  Zone* zone = ctx->zp2;
+  // The twilight zone is a single contour of all its points.
+  const bool twilight = ctx->gs.gep2 == kTwilightZone;
+  const std::vector<uint16_t>& ends = ctx->contour_ends;
+  if (contour >= (twilight ? 1 : ends.size())) {
+    ctx->fail(HintError::kInvalidReference);
+    return;
+  }
+  ReferenceShift shift;
+  if (!referenceShift(opcode, ctx, &shift))
+    return;
+  const size_t begin = (twilight || contour == 0) ? 0 : ends[contour - 1] + 1;
+  const size_t end = twilight
+      ? zone->size() : std::min<size_t>(ends[contour] + 1, zone->size());
+  shiftPoints(ctx->gs.freedom_vector, shift.dx, shift.dy, true, zone, begin,
+              end, shift.zone, shift.point);
+}
+
+void SHZ(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t n = ctx->stack.top(); ctx->stack.pop();
+  if (n != kTwilightZone && n != kGlyphZone) {
+    ctx->fail(HintError::kInvalidReference);
+    return;
+  }
+  ReferenceShift shift;
+  if (!referenceShift(opcode, ctx, &shift))
+    return;
+  // Like FreeType, zp2 is shifted whichever zone is given, without touching
+  // the points, and the phantom points stay.
+  Zone* zone = ctx->zp2;
+  size_t end = 0;
+  if (ctx->gs.gep2 == kTwilightZone)
+    end = zone->size();
+  else if (!ctx->contour_ends.empty())
+    end = std::min<size_t>(ctx->contour_ends.back() + 1, zone->size());
+  shiftPoints(ctx->gs.freedom_vector, shift.dx, shift.dy, false, zone, 0, end,
+              shift.zone, shift.point);
+}
+
+void RTDG(int opcode, const HintInstruction& inst, Context* ctx) {
+  ctx->gs.round_state = kRoundToDoubleGrid;
+}
+
+void MPS(int opcode, const HintInstruction& inst, Context* ctx) {
+  // The same as MPPEM, like FreeType.
+  ctx->stack.push(ctx->ppem);
+}
+
+void FLIPON(int opcode, const HintInstruction& inst, Context* ctx) {
+  ctx->gs.auto_flip = true;
+}
+
+void FLIPOFF(int opcode, const HintInstruction& inst, Context* ctx) {
+  ctx->gs.auto_flip = false;
+}
+
+// Stops the program, like FreeType.
+void DEBUG(int opcode, const HintInstruction& inst, Context* ctx) {
+  ctx->fail(HintError::kInvalidInstruction);
+}
+
+void ODD(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 value = ctx->stack.top(); ctx->stack.pop();
+  ctx->stack.push((ctx->round(value) & 127) == 64 ? 1 : 0);
+}
+
+void EVEN(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 value = ctx->stack.top(); ctx->stack.pop();
+  ctx->stack.push((ctx->round(value) & 127) == 0 ? 1 : 0);
+}
+
+void CEILING(int opcode, const HintInstruction& inst, Context* ctx) {
+  F26Dot6 value = ctx->stack.top(); ctx->stack.pop();
+  ctx->stack.push(pixelCeil(value));
+}
+
+void NROUND(int opcode, const HintInstruction& inst, Context* ctx) {
+  // Without the engine compensation, the value stays as it is.
+}
+
+void DELTAP2(int opcode, const HintInstruction& inst, Context* ctx) {
+  DELTAP1(opcode, inst, ctx);
+}
+
+void DELTAP3(int opcode, const HintInstruction& inst, Context* ctx) {
+  DELTAP1(opcode, inst, ctx);
+}
+
+void DELTAC2(int opcode, const HintInstruction& inst, Context* ctx) {
+  DELTAC1(opcode, inst, ctx);
+}
+
+void DELTAC3(int opcode, const HintInstruction& inst, Context* ctx) {
+  DELTAC1(opcode, inst, ctx);
+}
+
+void S45ROUND(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t selector = ctx->stack.top(); ctx->stack.pop();
+  // sqrt(2) / 2 pixels.
+  ctx->gs.setSuperRound(0x2D41, selector);
+  ctx->gs.round_state = kRoundSuper45;
+}
+
+void SANGW(int opcode, const HintInstruction& inst, Context* ctx) {
+  // Obsolete.
+  ctx->stack.pop();
+}
+
+void AA(int opcode, const HintInstruction& inst, Context* ctx) {
+  // Obsolete.
+  ctx->stack.pop();
+}
+
+void FLIPPT(int opcode, const HintInstruction& inst, Context* ctx) {
+  if (!ctx->hasLoopPoints())
+    return;
+  Zone* zone = &ctx->glyph_zone;
+  for (; ctx->gs.loop > 0; --ctx->gs.loop) {
+    uint32_t p = ctx->stack.top(); ctx->stack.pop();
+    if (p >= zone->size())
+      continue;
+    zone->flags[p] ^= kOnCurve;
+  }
+  ctx->gs.loop = 1;
+}
+
+void FLIPRGON(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t last = ctx->stack.top(); ctx->stack.pop();
+  uint32_t first = ctx->stack.top(); ctx->stack.pop();
+  Zone* zone = &ctx->glyph_zone;
+  if (!ctx->hasPoint(*zone, first) || !ctx->hasPoint(*zone, last))
+    return;
+  for (uint32_t p = first; p <= last; ++p)
+    zone->flags[p] |= kOnCurve;
+}
+
+void FLIPRGOFF(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t last = ctx->stack.top(); ctx->stack.pop();
+  uint32_t first = ctx->stack.top(); ctx->stack.pop();
+  Zone* zone = &ctx->glyph_zone;
+  if (!ctx->hasPoint(*zone, first) || !ctx->hasPoint(*zone, last))
+    return;
+  for (uint32_t p = first; p <= last; ++p)
+    zone->flags[p] &= ~kOnCurve;
+}
+
+void MDRP(int opcode, const HintInstruction& inst, Context* ctx) {
+  uint32_t p = ctx->stack.top(); ctx->stack.pop();
+  const uint32_t rp0 = ctx->gs.rp0;
+  const Zone& ref = *ctx->zp0;
+  Zone* zone = ctx->zp1;
+  if (!ctx->hasPoint(ref, rp0) || !ctx->hasPoint(*zone, p))
+    return;
+
+  F26Dot6 original = originalDistance(*zone, p, ref, rp0, ctx);
+  const GraphicsState& gs = ctx->gs;
+  if (gs.single_width_cutin > 0 &&
+      original < gs.single_width_value + gs.single_width_cutin &&
+      original > gs.single_width_value - gs.single_width_cutin) {
+    original = original >= 0 ? gs.single_width_value
+                             : -gs.single_width_value;
+  }
+  F26Dot6 distance = (opcode & 4) ? ctx->round(original) : original;
+  if (opcode & 8)
+    distance = keepMinimumDistance(original, distance, gs);
+
+  F26Dot6 current = ctx->project(zone->cur_x[p] - ref.cur_x[rp0],
+                                 zone->cur_y[p] - ref.cur_y[rp0]);
+  ctx->move(zone, p, distance - current);
+  ctx->gs.rp1 = rp0;
+  ctx->gs.rp2 = p;
+  if (opcode & 16)
+    ctx->gs.rp0 = p;
+}
+
+// The stack guard policies of the interpreter loop.
+
+// Stops an instruction popping more values than the stack has, pushing more
+// than it holds or indexing past its bottom, from the instruction metadata.
+// The instructions repeated by SLOOP and the DELTAs check their points and
+// pairs themselves.
+struct CheckedStack {
+  static bool allows(const Context& ctx, const HintInstruction& inst) {
+    const InstructionInfo& info = kInstructionInfo[inst.opcode];
+    const size_t depth = ctx.stack.size();
+    if (depth < info.pops)
+      return false;
+    const size_t pushes =
+        info.effect == StackEffect::kPush ? inst.count : info.pushes;
+    if (depth - info.pops + pushes > ctx.stack.capacity())
+      return false;
+    if (info.effect == StackEffect::kIndex) {
+      const int32_t k = ctx.stack.top();
+      return k >= 1 && (size_t)k < depth;
+    }
+    return true;
+  }
+};
+
+// Checks nothing, for the programs HintVerifier proved.
+struct VerifiedStack {
+  static bool allows(const Context& ctx, const HintInstruction& inst) {
+    return true;
+  }
+};
+
+// The tracing policies of the interpreter loop.
+
+// Does nothing, for hinting.
+struct NoTrace {
+  void before(const Context& ctx, const HintInstruction& inst) {}
+  void after(const Context& ctx) {}
+};
+
+// The HintTraceField bits of the fields different between |a| and |b|.
+uint32_t changedFields(const GraphicsState& a, const GraphicsState& b) {
+  uint32_t fields = 0;
+  if (a.freedom_vector.x != b.freedom_vector.x ||
+      a.freedom_vector.y != b.freedom_vector.y)
+    fields |= kTraceFreedomVector;
+  if (a.projection_vector.x != b.projection_vector.x ||
+      a.projection_vector.y != b.projection_vector.y)
+    fields |= kTraceProjectionVector;
+  if (a.dual_vector.x != b.dual_vector.x || a.dual_vector.y != b.dual_vector.y)
+    fields |= kTraceDualVector;
+  if (a.gep0 != b.gep0 || a.gep1 != b.gep1 || a.gep2 != b.gep2)
+    fields |= kTraceZonePointers;
+  if (a.rp0 != b.rp0 || a.rp1 != b.rp1 || a.rp2 != b.rp2)
+    fields |= kTraceReferencePoints;
+  if (a.loop != b.loop)
+    fields |= kTraceLoop;
+  if (a.minimum_distance != b.minimum_distance)
+    fields |= kTraceMinimumDistance;
+  if (a.round_state != b.round_state || a.period != b.period ||
+      a.phase != b.phase || a.threshold != b.threshold)
+    fields |= kTraceRoundState;
+  if (a.auto_flip != b.auto_flip)
+    fields |= kTraceAutoFlip;
+  if (a.control_value_cutin != b.control_value_cutin ||
+      a.single_width_cutin != b.single_width_cutin ||
+      a.single_width_value != b.single_width_value)
+    fields |= kTraceCutIn;
+  if (a.scan_control != b.scan_control || a.scan_type != b.scan_type)
+    fields |= kTraceScanControl;
+  if (a.delta_base != b.delta_base || a.delta_shift != b.delta_shift)
+    fields |= kTraceDelta;
+  if (a.instruction_control != b.instruction_control)
+    fields |= kTraceInstructionControl;
+  return fields;
+}
+
+// Copies |gs| into the trace record |out|.
+void traceState(const GraphicsState& gs, HintTraceState* out) {
+  out->freedom_vector[0] = gs.freedom_vector.x;
+  out->freedom_vector[1] = gs.freedom_vector.y;
+  out->projection_vector[0] = gs.projection_vector.x;
+  out->projection_vector[1] = gs.projection_vector.y;
+  out->dual_vector[0] = gs.dual_vector.x;
+  out->dual_vector[1] = gs.dual_vector.y;
+  out->gep[0] = gs.gep0;
+  out->gep[1] = gs.gep1;
+  out->gep[2] = gs.gep2;
+  out->rp[0] = gs.rp0;
+  out->rp[1] = gs.rp1;
+  out->rp[2] = gs.rp2;
+  out->loop = gs.loop;
+  out->minimum_distance = gs.minimum_distance;
+  out->round_state = gs.round_state;
+  out->period = gs.period;
+  out->phase = gs.phase;
+  out->threshold = gs.threshold;
+  out->auto_flip = gs.auto_flip;
+  out->control_value_cutin = gs.control_value_cutin;
+  out->single_width_cutin = gs.single_width_cutin;
+  out->single_width_value = gs.single_width_value;
+  out->scan_control = gs.scan_control;
+  out->scan_type = gs.scan_type;
+  out->delta_base = gs.delta_base;
+  out->delta_shift = gs.delta_shift;
+  out->instruction_control = gs.instruction_control;
+}
+
+// Records each instruction into a HintTrace. The programs other than
+// |fpgm| and |prep| are the glyph program.
+class RingTrace {
+ public:
+  RingTrace(HintTrace* trace, const HintProgram* fpgm,
+            const HintProgram* prep)
+      : trace_(trace), fpgm_(fpgm), prep_(prep) {}
+
+  void before(const Context& ctx, const HintInstruction& inst) {
+    record_.program = ctx.program == fpgm_ ? HintProgramKind::kFont
+        : ctx.program == prep_ ? HintProgramKind::kControlValue
+        : HintProgramKind::kGlyph;
+    record_.opcode = inst.opcode;
+    record_.call_depth = ctx.call_stack.size();
+    record_.pc = ctx.program->byteOffset(ctx.pc - 1);
+    record_.stack_depth = ctx.stack.size();
+    gs_ = ctx.gs;
+  }
+
+  void after(const Context& ctx) {
+    record_.gs_changes = changedFields(gs_, ctx.gs);
+    if (record_.gs_changes)
+      traceState(ctx.gs, &record_.gs);
+    trace_->add(record_);
+  }
+
+ private:
+  HintTrace* trace_;
+  const HintProgram* fpgm_;
+  const HintProgram* prep_;
+  HintTraceRecord record_;
+  GraphicsState gs_;
+};
+
+// Writes the name of |opcode| with its variant bits.
+void writeInstructionName(uint8_t opcode, std::ostream* os) {
+  switch (opcode) {
+#define V(name, variant, code) \
+    case code: *os << #name << "[" << #variant << "]"; break;
+    FOR_EACH_INSTRUCTIONS(V)
+#undef V
+    default:
+      *os << "0x" << std::hex << (uint32_t)opcode << std::dec;
+  }
+}
+
+}  // namespace
+
+template <typename Guard, typename Tracer>
+bool HintStackMachine::Context::run(const HintProgram& p, Tracer* tracer) {
+  program = &p;
+  pc = 0;
+  stack.clear();
+  call_stack.clear();
+  call_stack.reserve(budget.max_call_depth);
+  error = HintError::kNone;
+  const bool has_deadline = budget.max_microseconds != 0;
+  const std::chrono::steady_clock::time_point deadline = has_deadline
+      ? std::chrono::steady_clock::now() +
+            std::chrono::microseconds(budget.max_microseconds)
+      : std::chrono::steady_clock::time_point();
+  uint32_t instructions_left = budget.max_instructions;
+  while (error == HintError::kNone) {
+    if (pc >= program->size()) {
+      // A function has to end with ENDF.
+      if (!call_stack.empty())
+        fail(HintError::kInvalidInstruction);
+      break;
+    }
+    if (instructions_left == 0) {
+      fail(HintError::kInstructionBudget);
+      break;
+    }
+    --instructions_left;
+    if (has_deadline && instructions_left % kDeadlineInterval == 0 &&
+        std::chrono::steady_clock::now() >= deadline) {
+      fail(HintError::kDeadline);
+      break;
+    }
+    const HintInstruction& inst = (*program)[pc++];
+    if (!Guard::allows(*this, inst)) {
+      fail(HintError::kStackBounds);
+      break;
+    }
+    tracer->before(*this, inst);
+    kHandlerTable.handlers[inst.opcode](inst.opcode, inst, this);
+    tracer->after(*this);
+  }
+  return error == HintError::kNone;
+}
+
+HintStackMachine::HintStackMachine(const FontFace& face, int grid_size)
+    : face_(face), grid_size_(grid_size), trace_(nullptr) {}
+
+HintStackMachine::~HintStackMachine() {}
+
+const HintStackMachine::PrepState& HintStackMachine::prepare() {
+  if (prep_state_)
+    return *prep_state_;
+
+  context_.reset(new Context(face_, grid_size_));
+  Context& ctx = *context_;
+  const MaxpSubTable& maxp = face_.maxp();
+  std::unique_ptr<PrepState> state(new PrepState());
+  const FunctionDef undefined = { nullptr, 0 };
+  state->functions.assign(maxp.max_function_defs(), undefined);
+  state->instruction_defs.assign(256, undefined);
+  state->storage.assign(maxp.max_storage(), 0);
+  // The twilight points start at the origin. Like FreeType, a few points
+  // more than maxp says are allowed.
+  state->twilight.resize(maxp.max_twilight_points() + kNumPhantomPoints);
+  const std::vector<int16_t>& cvt = face_.cvt().cvt();
+  state->cvt.resize(cvt.size());
+  for (size_t i = 0; i < cvt.size(); ++i)
+    state->cvt[i] = mulFix(cvt[i], ctx.scale);
+  state->error = HintError::kNone;
+  if (!fpgm_program_.decode(face_.fpgm().instructions()) ||
+      !prep_program_.decode(face_.prep().instructions()))
+    state->error = HintError::kInvalidInstruction;
+
+  // The functions are summarized again after each program defines some.
+  const size_t capacity = maxp.max_stack_elements() + kStackMargin;
+  ctx.loadPrep(state.get());
+  verifier_.setFunctions(&state->functions, capacity);
+  if (state->error == HintError::kNone)
+    state->error = run(fpgm_program_, verifier_.verify(fpgm_program_, true));
+  // Only the definitions of the font program are kept. The control value
+  // program starts from the default state and the clear storage.
+  ctx.loadPrep(state.get());
+  verifier_.setFunctions(&state->functions, capacity);
+  ctx.in_control_value_program = true;
+  if (state->error == HintError::kNone)
+    state->error = run(prep_program_, verifier_.verify(prep_program_, true));
+  ctx.in_control_value_program = false;
+  verifier_.setFunctions(&state->functions, capacity);
+  // The glyph programs start from these whatever the control value program
+  // sets.
+  ctx.gs.resetForGlyph();
+  ctx.gs.rp0 = ctx.gs.rp1 = ctx.gs.rp2 = 0;
+  ctx.savePrep(state.get());
+  prep_state_ = std::move(state);
+  return *prep_state_;
+}
+
+HintError HintStackMachine::run(const HintProgram& program, bool verified) {
+  Context& ctx = *context_;
+  ctx.budget = budget_;
+  if (trace_) {
+    RingTrace tracer(trace_, &fpgm_program_, &prep_program_);
+    ctx.run<CheckedStack>(program, &tracer);
+  } else {
+    NoTrace tracer;
+    if (verified)
+      ctx.run<VerifiedStack>(program, &tracer);
+    else
+      ctx.run<CheckedStack>(program, &tracer);
+  }
+  return ctx.error;
+}
+
+bool HintStackMachine::execute(
+    const SimpleGlyphData& glyph,
+    Outline* outline,
+    ScanControl* scan_control) {
+  // The components of a composite glyph would have to be hinted one by one
+  // before its own program runs.
+  if (glyph.composite)
+    return false;
+
+  const PrepState& prep_state = prepare();
+  HintError error = prep_state.error;
+  // The control value program may turn the hinting off.
+  if (error == HintError::kNone && (prep_state.gs.instruction_control & 1))
+    return false;
+  Context& ctx = *context_;
+  if (error == HintError::kNone) {
+    if (glyph_program_.decode(glyph.instructions)) {
+      ctx.loadGlyph(prep_state, glyph);
+      error = run(glyph_program_, verifier_.verify(glyph_program_, false));
+    } else {
+      error = HintError::kInvalidInstruction;
+    }
+  }
+  if (error != HintError::kNone) {
+    ++stats_.failed[(size_t)error];
+    return false;
+  }
+  scan_control->dropout_control = ctx.gs.scan_control;
+  scan_control->scan_type = ctx.gs.scan_type;
+  ctx.storeGlyph(outline);
+  ++stats_.hinted;
+  return true;
 }
 
 // static
 void HintStackMachine::dumpInstructions(const std::vector<uint8_t>& inst) {
-  int pc = 0;
-  while (pc < inst.size()) {
-    switch (inst[pc++]) {
-#define V(name, variant, opcode, is_move) \
-      case opcode: LOG(ERROR) << (pc - 1) << ": " << #name << "[" << #variant << "]"; \
-                   pc = is_move(inst, pc); break;
-      FOR_EACH_INSTRUCTIONS(V)
-#undef V
-      default:
-        LOG(FATAL) << "Uknown opcode pc = " << pc <<
-            ", 0x" << std::setfill('0') << std::setw(2)
-            << std::hex << (uint32_t)inst[pc -1];
+  HintProgram program;
+  if (!program.decode(inst)) {
+    LOG(ERROR) << "Invalid instructions.";
+    return;
+  }
+  for (size_t i = 0; i < program.size(); ++i) {
+    const HintInstruction& decoded = program[i];
+    std::stringstream ss;
+    writeInstructionName(decoded.opcode, &ss);
+    for (int j = 0; j < decoded.count; ++j)
+      ss << (j == 0 ? " : " : ", ") << program.values()[decoded.arg + j];
+    LOG(ERROR) << program.byteOffset(i) << ": " << ss.str();
+  }
+}
+
+// Writes the new value of the HintTraceField |field| in |gs|.
+void writeTraceField(uint32_t field, const HintTraceState& gs,
+                     std::ostream* os) {
+  switch (field) {
+    case kTraceFreedomVector:
+      *os << "(" << gs.freedom_vector[0] << ", " << gs.freedom_vector[1]
+          << ")";
+      break;
+    case kTraceProjectionVector:
+      *os << "(" << gs.projection_vector[0] << ", "
+          << gs.projection_vector[1] << ")";
+      break;
+    case kTraceDualVector:
+      *os << "(" << gs.dual_vector[0] << ", " << gs.dual_vector[1] << ")";
+      break;
+    case kTraceZonePointers:
+      *os << gs.gep[0] << "," << gs.gep[1] << "," << gs.gep[2];
+      break;
+    case kTraceReferencePoints:
+      *os << gs.rp[0] << "," << gs.rp[1] << "," << gs.rp[2];
+      break;
+    case kTraceLoop:
+      *os << gs.loop;
+      break;
+    case kTraceMinimumDistance:
+      *os << gs.minimum_distance;
+      break;
+    case kTraceRoundState:
+      *os << gs.round_state << " (" << gs.period << ", " << gs.phase << ", "
+          << gs.threshold << ")";
+      break;
+    case kTraceAutoFlip:
+      *os << gs.auto_flip;
+      break;
+    case kTraceCutIn:
+      *os << gs.control_value_cutin << ", " << gs.single_width_cutin << ", "
+          << gs.single_width_value;
+      break;
+    case kTraceScanControl:
+      *os << gs.scan_control << ", " << gs.scan_type;
+      break;
+    case kTraceDelta:
+      *os << gs.delta_base << ", " << gs.delta_shift;
+      break;
+    case kTraceInstructionControl:
+      *os << gs.instruction_control;
+      break;
+  }
+}
+
+// static
+void HintStackMachine::dumpTrace(const HintTrace& trace) {
+  static const char* const kProgramNames[] = { "fpgm", "prep", "glyf" };
+  static const char* const kFieldNames[] = {
+    "fv", "pv", "dpv", "gep", "rp", "loop", "minimum_distance", "round",
+    "auto_flip", "cut_in", "scan_control", "delta", "instruction_control",
+  };
+  if (trace.dropped())
+    LOG(ERROR) << trace.dropped() << " older instructions dropped";
+  for (size_t i = 0; i < trace.size(); ++i) {
+    const HintTraceRecord& record = trace[i];
+    std::stringstream ss;
+    ss << kProgramNames[(int)record.program] << " " << record.pc << ": ";
+    writeInstructionName(record.opcode, &ss);
+    ss << " stack " << record.stack_depth << " calls " << record.call_depth;
+    for (size_t bit = 0; bit < sizeof(kFieldNames) / sizeof(kFieldNames[0]);
+         ++bit) {
+      if (record.gs_changes & (1u << bit)) {
+        ss << " " << kFieldNames[bit] << "=";
+        writeTraceField(1u << bit, record.gs, &ss);
+      }
     }
+    LOG(ERROR) << ss.str();
   }
 }
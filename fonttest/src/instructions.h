@@ -1,15 +1,134 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
 #include "glyf.h"
+#include "hint_program.h"
+#include "hint_trace.h"
+#include "hint_verifier.h"
+
+class FontFace;
+
+// The scan conversion state set by SCANCTRL and SCANTYPE.
+struct ScanControl {
+  ScanControl() : dropout_control(false), scan_type(0) {}
+  bool dropout_control;
+  int scan_type;
+};
+
+// Why a hint program was stopped.
+enum class HintError : uint8_t {
+  kNone,
+  // A program that does not decode, an undefined opcode, DEBUG, or FDEF,
+  // IDEF or ENDF where they are not allowed.
+  kInvalidInstruction,
+  // An instruction popping more values than the stack has or pushing more
+  // than it holds.
+  kStackBounds,
+  // A point, contour, zone, cvt entry, storage location, function or jump
+  // target that does not exist.
+  kInvalidReference,
+  // A negative loop count, a delta shift over 6 or a division by zero.
+  kInvalidArgument,
+  // CALL and LOOPCALL nested deeper than HintBudget::max_call_depth.
+  kCallDepth,
+  // More instructions than HintBudget::max_instructions.
+  kInstructionBudget,
+  // Longer than HintBudget::max_microseconds.
+  kDeadline,
+};
+
+const size_t kNumHintErrors = 8;
+
+// Limits each run of the font program, the control value program and a
+// glyph program, so that a broken or hostile font cannot hang or crash the
+// hinting. The instructions of the functions called count.
+struct HintBudget {
+  HintBudget()
+      : max_instructions(1000000), max_microseconds(100000),
+        max_call_depth(32) {}
 
-class TrueType;
+  uint32_t max_instructions;
+  // No limit if zero. The clock is read every few thousand instructions.
+  uint32_t max_microseconds;
+  uint32_t max_call_depth;
+};
+
+// How the glyphs of a face were hinted.
+struct HintStats {
+  HintStats() : hinted(0), failed() {}
 
+  uint64_t hinted;
+  // The glyphs drawn unhinted for each HintError stopping the glyph program,
+  // or the font program or the control value program before it.
+  uint64_t failed[kNumHintErrors];
+};
+
+// Hints the glyphs of a face at one size. The font program and the control
+// value program depend only on the face and the size, so they run once, on
+// the first glyph, and each glyph program starts from a copy of the
+// functions, storage, cvt and graphics state they leave.
+//
+// The execution context is allocated once, sized from maxp, and reused for
+// every glyph, so hinting a glyph does not allocate. A HintStackMachine is
+// used on one thread at a time.
+//
+// A program stopped by HintBudget or by an error leaves the glyph unhinted.
+// If it is the font program or the control value program, every glyph of the
+// size is left unhinted.
 class HintStackMachine {
  public:
+  HintStackMachine(const FontFace& face, int grid_size);
+  ~HintStackMachine();
+
+  HintStackMachine(const HintStackMachine&) = delete;
+  HintStackMachine& operator=(const HintStackMachine&) = delete;
+
   static void dumpInstructions(const std::vector<uint8_t>& inst);
+  static void dumpTrace(const HintTrace& trace);
+
+  // Records the instructions run from now on into |trace| until it is set
+  // to nullptr. The interpreter is built separately for tracing, so hinting
+  // without a trace has no tracing code.
+  void setTrace(HintTrace* trace) { trace_ = trace; }
+
+  // Limits the programs run from now on.
+  void setBudget(const HintBudget& budget) { budget_ = budget; }
+
+  const HintStats& stats() const { return stats_; }
+
+  // Writes the hinted outline of |glyph| into |outline| in 26.6 pixels.
+  // Returns false, leaving |outline| alone, if the glyph is not hinted.
+  bool execute(const SimpleGlyphData& glyph, Outline* outline,
+               ScanControl* scan_control);
+
+  // Defined in instructions.cc.
+  struct PrepState;
+  struct Context;
+
+ private:
+  // Runs the font program and the control value program unless done.
+  const PrepState& prepare();
+
+  // Runs |program| with the tracing build of the interpreter if tracing, or
+  // else without the stack checks if it is |verified|. Returns why the
+  // program is stopped, or HintError::kNone.
+  HintError run(const HintProgram& program, bool verified);
+
+  const FontFace& face_;
+  const int grid_size_;
 
-  static std::vector<Contour> execute(
-      const SimpleGlyphData& glyph,
-      int grid_size,
-      const TrueType& truetype);
+  // The functions defined by fpgm and prep point into their programs.
+  HintProgram fpgm_program_;
+  HintProgram prep_program_;
+  HintProgram glyph_program_;
+  std::unique_ptr<PrepState> prep_state_;
+  std::unique_ptr<Context> context_;
+  HintVerifier verifier_;
+  HintTrace* trace_;
+  HintBudget budget_;
+  HintStats stats_;
 };
@@ -1,6 +1,6 @@
 #include "loca.h"
 
-#include "utils.h"
+#include "big_endian.h"
 
 #include <glog/logging.h>
 
@@ -18,8 +18,8 @@ LocaSubTable::LocaSubTable(const void* ptr, size_t length, uint32_t num_glyphs)
 
 uint32_t LocaSubTable::findGlyfOffset(uint16_t glyph_id) const {
   if (is_short_) {
-      return readU16(ptr_, glyph_id * 2) * 2;
+      return recordAt<UInt16>(ptr_, 0)[glyph_id] * 2;
   } else {
-      return readU32(ptr_, glyph_id * 4);
+      return recordAt<UInt32>(ptr_, 0)[glyph_id];
   }
 }
@@ -9,6 +9,8 @@ class LocaSubTable {
 
   uint32_t findGlyfOffset(uint16_t glyph_id) const;
 
+  uint32_t num_glyphs() const { return num_glyphs_; }
+
  private:
   uint32_t num_glyphs_;
 
@@ -3,19 +3,21 @@
 #include <glog/logging.h>
 #include <memory>
 #include <math.h>
+#include <string.h>
 
-#include "truetype.h"
-#include "cmap.h"
-#include "loca.h"
+#include "cmap_index.h"
+#include "font_face.h"
 #include "glyf.h"
+#include "glyph_cache.h"
 #include "image.h"
 #include "gui.h"
-#include "head.h"
-#include "cvt.h"
-#include "prep.h"
-#include "fpgm.h"
 #include "rasterizer.h"
 
+// Converts the 26.6 pixels back into font units at the 16.16 |scale|.
+static int toFontUnits(F26Dot6 value, F16Dot16 scale) {
+  return (int)((int64_t)value * 0x10000 / scale);
+}
+
 int main (int argc, char *argv[]) {
   google::InitGoogleLogging(argv[0]);
   gtk_init (&argc, &argv);
@@ -32,47 +34,29 @@ int main (int argc, char *argv[]) {
     LOG(ERROR) << "Not supported file: " << fname;
   }
 
-  TrueType ttf(fname, index);
+  FontFace face(fname, index);
   int px = argc == (char_arg_index + 2) ? atoi(argv[char_arg_index + 1]) : 12;
 
   const char* ch_str = argv[char_arg_index];
-  uint32_t ucs4 = 0;
+  const CmapIndex& cmap_index = face.cmap_index();
+  std::vector<uint32_t> glyph_ids;
   if (ch_str[0] == 'U' && ch_str[1] == '+') {
-    ucs4 = (uint32_t)strtol(ch_str + 2, NULL, 16);
-  } else {
-    uint8_t leading = ch_str[0];
-    size_t utf8_len;
-    if (leading < 0x80) {
-      utf8_len = 1;
-      ucs4 = leading;
-    } else if ((leading & 0xe0) == 0xc0) {
-      utf8_len = 2;
-      ucs4 = leading & 0x1f;
-    } else if ((leading & 0xf0) == 0xe0) {
-      utf8_len = 3;
-      ucs4 = leading & 0x0f;
-    } else if ((leading & 0xf8) == 0xf0) {
-      utf8_len = 4;
-      ucs4 = leading & 0x07;
-    }
-
-    for (int i = 1; i < utf8_len; ++i) {
-      ucs4 <<= 6;
-      ucs4 += ch_str[i] & 0x3f;
-    }
+    glyph_ids.push_back(
+        cmap_index.findGlyphId((uint32_t)strtol(ch_str + 2, NULL, 16)));
+  } else if (!cmap_index.findGlyphIdsFromUtf8(ch_str, strlen(ch_str),
+                                              &glyph_ids)) {
+    LOG(ERROR) << "Invalid UTF-8: " << ch_str;
   }
+  if (glyph_ids.empty())
+    LOG(FATAL) << "No character is specified.";
+  // The missing glyph for an unmapped character.
+  uint32_t glyphId = glyph_ids[0] == (uint32_t)-1 ? 0 : glyph_ids[0];
+  LOG(ERROR) << std::hex << "GlyphId[" << ch_str << "] = 0x" << glyphId;
 
-  std::unique_ptr<CmapSubTable> cmap(ttf.getCmap());
-  uint32_t glyphId = cmap->findGlyphId(ucs4, 0);
-  LOG(ERROR) << std::hex << "GlyphId[U+" << ucs4 << "] = 0x" << glyphId;
-
-  std::unique_ptr<LocaSubTable> loca(ttf.getLoca());
-  std::unique_ptr<GlyfSubTable> glyf(ttf.getGlyf());
-  std::unique_ptr<SimpleGlyphData> simpleGlyph(
-      static_cast<SimpleGlyphData*>(
-          glyf->getGlyfData(loca->findGlyfOffset(glyphId), loca.get()).release()));
-
-  std::unique_ptr<HeadSubTable> head(ttf.getHead());
+  GlyphCache glyphs(face.glyf(), face.loca(), face.num_glyphs());
+  const SimpleGlyphData* simpleGlyph = glyphs.get(glyphId);
+  if (!simpleGlyph)
+    LOG(FATAL) << "Broken glyph: " << glyphId;
 
   uint32_t cx = -simpleGlyph->x_min;
   uint32_t cy = -simpleGlyph->y_min;
@@ -80,49 +64,47 @@ int main (int argc, char *argv[]) {
   uint32_t h = simpleGlyph->y_max - simpleGlyph->y_min;
   Gui gui(w, h, cx, cy, 0.3, 100);
 
-  Rasterizer rasterizer(px, head->unit_per_em(), ttf);
+  Rasterizer rasterizer(px, face.unit_per_em(), face);
 
   int x_grid_num;
-  std::vector<char> pixels;
+  std::vector<uint8_t> pixels;
 
-  rasterizer.rasterize(*simpleGlyph.get(), &pixels, &x_grid_num, &gui);
+  rasterizer.rasterize(*simpleGlyph, RenderMode::kMono, &pixels,
+                       &x_grid_num, &gui);
 
   int y_grid_num = pixels.size() / x_grid_num;
-  int grid = rasterizer.grid_size();
-
-  for (int i = 0; i < x_grid_num + 1; ++i) {
-    gui.drawLine(
-        simpleGlyph->x_min + i * grid,
-        simpleGlyph->y_min,
-        simpleGlyph->x_min + i * grid,
-        simpleGlyph->y_min + y_grid_num * grid, 
-        "gray");
-  }
 
-  for (int j = 0; j < y_grid_num + 1; ++j) {
-    gui.drawLine(
-        simpleGlyph->x_min,
-        simpleGlyph->y_min + j * grid,
-        simpleGlyph->x_min + x_grid_num * grid,
-        simpleGlyph->y_min + j * grid,
-        "gray");
-  }
+  // The pixel edges in font units, from the origin the bitmap was placed at.
+  F16Dot16 scale = rasterizer.scale();
+  std::vector<int> xs(x_grid_num + 1);
+  std::vector<int> ys(y_grid_num + 1);
+  for (int i = 0; i <= x_grid_num; ++i)
+    xs[i] = toFontUnits(rasterizer.origin_x() + i * kF26Dot6One, scale);
+  for (int j = 0; j <= y_grid_num; ++j)
+    ys[j] = toFontUnits(rasterizer.origin_y() + j * kF26Dot6One, scale);
+
+  for (int i = 0; i < x_grid_num + 1; ++i)
+    gui.drawLine(xs[i], ys[0], xs[i], ys[y_grid_num], "gray");
+
+  for (int j = 0; j < y_grid_num + 1; ++j)
+    gui.drawLine(xs[0], ys[j], xs[x_grid_num], ys[j], "gray");
 
   for (int ix = 0; ix < x_grid_num; ++ix) {
     for (int iy = 0; iy < y_grid_num; ++iy) {
       if (pixels[iy * x_grid_num + ix] == 0)
         continue;
       gui.fillRect(
-          simpleGlyph->x_min + ix * grid,
-          simpleGlyph->y_min + (iy + 1) * grid,
-          grid,
-          grid,
+          xs[ix],
+          ys[iy + 1],
+          xs[ix + 1] - xs[ix],
+          ys[iy + 1] - ys[iy],
           "black");
     }
   }
 
-  gui.drawPath(simpleGlyph->contours, false, "blue", true, 3.0);
-  rasterizer.rasterize(*simpleGlyph.get(), &pixels, &x_grid_num, &gui);
+  gui.drawPath(simpleGlyph->outline, false, "blue", true, 3.0);
+  rasterizer.rasterize(*simpleGlyph, RenderMode::kMono, &pixels,
+                       &x_grid_num, &gui);
 
   gtk_main();
 
@@ -1,15 +1,59 @@
 #include "maxp.h"
 
-#include "utils.h"
+#include "big_endian.h"
 #include <glog/logging.h>
 
-MaxpSubTable::MaxpSubTable(const void* ptr, size_t length) {
-  uint8_t* bytes = (uint8_t*)ptr;
-  uint32_t version = readU32(bytes, 0);
-  if (version == 0x00005000) {
-    num_glyphs_ = readU16(bytes, 4);
-  } else if (version == 0x00010000) {
-    num_glyphs_ = readU16(bytes, 4);
+namespace {
+
+struct MaxpRecord {
+  Fixed version;
+  UInt16 num_glyphs;
+};
+
+// The rest of a version 1.0 table.
+struct MaxpRecordV1 {
+  MaxpRecord header;
+  UInt16 max_points;
+  UInt16 max_contours;
+  UInt16 max_composite_points;
+  UInt16 max_composite_contours;
+  UInt16 max_zones;
+  UInt16 max_twilight_points;
+  UInt16 max_storage;
+  UInt16 max_function_defs;
+  UInt16 max_instruction_defs;
+  UInt16 max_stack_elements;
+  UInt16 max_size_of_instructions;
+  UInt16 max_component_elements;
+  UInt16 max_component_depth;
+};
+
+}  // namespace
+
+MaxpSubTable::MaxpSubTable(const void* ptr, size_t length)
+    : max_points_(0), max_contours_(0), max_zones_(0),
+      max_twilight_points_(0), max_storage_(0), max_function_defs_(0),
+      max_instruction_defs_(0), max_stack_elements_(0),
+      max_size_of_instructions_(0) {
+  const MaxpRecord* maxp = recordAt<MaxpRecord>(ptr, length, 0);
+  if (!maxp)
+    LOG(FATAL) << "Invalid maxp length: " << length;
+  if (maxp->version == 0x00005000) {
+    num_glyphs_ = maxp->num_glyphs;
+  } else if (maxp->version == 0x00010000) {
+    const MaxpRecordV1* v1 = recordAt<MaxpRecordV1>(ptr, length, 0);
+    if (!v1)
+      LOG(FATAL) << "Invalid maxp length: " << length;
+    num_glyphs_ = maxp->num_glyphs;
+    max_points_ = v1->max_points;
+    max_contours_ = v1->max_contours;
+    max_zones_ = v1->max_zones;
+    max_twilight_points_ = v1->max_twilight_points;
+    max_storage_ = v1->max_storage;
+    max_function_defs_ = v1->max_function_defs;
+    max_instruction_defs_ = v1->max_instruction_defs;
+    max_stack_elements_ = v1->max_stack_elements;
+    max_size_of_instructions_ = v1->max_size_of_instructions;
   } else {
     LOG(FATAL) << "Invalid version number";
   }
@@ -9,6 +9,29 @@ class MaxpSubTable {
 
   uint32_t num_glyphs() const { return num_glyphs_; }
 
+  // The limits of the hint programs. They are 0 in a version 0.5 table,
+  // which has no TrueType outlines.
+  uint32_t max_points() const { return max_points_; }
+  uint32_t max_contours() const { return max_contours_; }
+  uint32_t max_zones() const { return max_zones_; }
+  uint32_t max_twilight_points() const { return max_twilight_points_; }
+  uint32_t max_storage() const { return max_storage_; }
+  uint32_t max_function_defs() const { return max_function_defs_; }
+  uint32_t max_instruction_defs() const { return max_instruction_defs_; }
+  uint32_t max_stack_elements() const { return max_stack_elements_; }
+  uint32_t max_size_of_instructions() const {
+    return max_size_of_instructions_;
+  }
+
  private:
   uint32_t num_glyphs_;
+  uint32_t max_points_;
+  uint32_t max_contours_;
+  uint32_t max_zones_;
+  uint32_t max_twilight_points_;
+  uint32_t max_storage_;
+  uint32_t max_function_defs_;
+  uint32_t max_instruction_defs_;
+  uint32_t max_stack_elements_;
+  uint32_t max_size_of_instructions_;
 };
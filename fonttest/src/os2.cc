@@ -0,0 +1,48 @@
+#include "os2.h"
+
+#include "big_endian.h"
+#include <glog/logging.h>
+
+namespace {
+
+// The fields common to all the versions, up to the typographic metrics.
+struct Os2Record {
+  UInt16 version;
+  FWord x_avg_char_width;
+  UInt16 us_weight_class;
+  UInt16 us_width_class;
+  UInt16 fs_type;
+  FWord y_subscript_x_size;
+  FWord y_subscript_y_size;
+  FWord y_subscript_x_offset;
+  FWord y_subscript_y_offset;
+  FWord y_superscript_x_size;
+  FWord y_superscript_y_size;
+  FWord y_superscript_x_offset;
+  FWord y_superscript_y_offset;
+  FWord y_strikeout_size;
+  FWord y_strikeout_position;
+  Int16 s_family_class;
+  UInt8 panose[10];
+  UInt32 ul_unicode_range[4];
+  Tag ach_vend_id;
+  UInt16 fs_selection;
+  UInt16 us_first_char_index;
+  UInt16 us_last_char_index;
+  FWord s_typo_ascender;
+  FWord s_typo_descender;
+};
+
+}  // namespace
+
+Os2SubTable::Os2SubTable(const void* ptr, size_t length)
+    : empty_(true), typo_ascender_(0), typo_descender_(0) {
+  if (!ptr)
+    return;
+  const Os2Record* os2 = recordAt<Os2Record>(ptr, length, 0);
+  if (!os2)
+    LOG(FATAL) << "Invalid OS/2 length: " << length;
+  empty_ = false;
+  typo_ascender_ = os2->s_typo_ascender;
+  typo_descender_ = os2->s_typo_descender;
+}
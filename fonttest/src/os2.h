@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The OS/2 metrics used by hinting.
+class Os2SubTable {
+ public:
+  // |ptr| is nullptr if the font does not have the table.
+  Os2SubTable(const void* ptr, size_t length);
+
+  bool empty() const { return empty_; }
+
+  int16_t typo_ascender() const { return typo_ascender_; }
+  int16_t typo_descender() const { return typo_descender_; }
+
+ private:
+  bool empty_;
+  int16_t typo_ascender_;
+  int16_t typo_descender_;
+};
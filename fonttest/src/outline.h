@@ -0,0 +1,170 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// A glyph outline in the structure of arrays form. The points of all the
+// contours are contiguous, and the contour c is the points from
+// contourStart(c) to contour_ends[c], both inclusive. The coordinates are in
+// font units or, once scaled, in 26.6 pixels.
+//
+// Clearing keeps the capacity, so an outline reused for every glyph stops
+// allocating after the largest one.
+struct Outline {
+  std::vector<int32_t> x;
+  std::vector<int32_t> y;
+  std::vector<uint32_t> on_curve;  // one bit per point.
+  std::vector<uint16_t> contour_ends;
+
+  size_t numPoints() const { return x.size(); }
+  size_t numContours() const { return contour_ends.size(); }
+
+  size_t contourStart(size_t c) const {
+    return c == 0 ? 0 : contour_ends[c - 1] + 1;
+  }
+
+  bool isOnCurve(size_t i) const {
+    return (on_curve[i >> 5] >> (i & 31)) & 1;
+  }
+
+  void setOnCurve(size_t i, bool on) {
+    if (on)
+      on_curve[i >> 5] |= 1u << (i & 31);
+    else
+      on_curve[i >> 5] &= ~(1u << (i & 31));
+  }
+
+  void clear() {
+    x.clear();
+    y.clear();
+    on_curve.clear();
+    contour_ends.clear();
+  }
+
+  // Resizes the point arrays. All the points are off curve.
+  void resize(size_t num_points) {
+    x.resize(num_points);
+    y.resize(num_points);
+    on_curve.assign((num_points + 31) / 32, 0);
+  }
+
+  void addPoint(int32_t px, int32_t py, bool on) {
+    size_t i = x.size();
+    x.push_back(px);
+    y.push_back(py);
+    if ((i & 31) == 0)
+      on_curve.push_back(0);
+    if (on)
+      on_curve[i >> 5] |= 1u << (i & 31);
+  }
+
+  void removeLastPoint() {
+    size_t i = x.size() - 1;
+    x.pop_back();
+    y.pop_back();
+    if ((i & 31) == 0)
+      on_curve.pop_back();
+    else
+      setOnCurve(i, false);
+  }
+
+  // Ends the current contour at the last added point.
+  void closeContour() { contour_ends.push_back(x.size() - 1); }
+};
+
+// Turns the points of contours into path commands, one point at a time, the
+// same way as a font renderer draws them: two adjacent off curve points imply
+// an on curve point in the middle. The path starts from the first on curve
+// point, real or implied; an off curve point before it is drawn when the
+// contour closes. |sink| has
+//   moveTo(x, y), lineTo(x, y), quadTo(cx, cy, x, y) and close().
+template <typename Sink>
+class ContourDecomposer {
+ public:
+  explicit ContourDecomposer(Sink* sink) : sink_(sink) { reset(); }
+
+  void addPoint(int32_t x, int32_t y, bool on_curve) {
+    if (!started_) {
+      if (on_curve) {
+        start(x, y);
+      } else if (!has_first_off_) {
+        has_first_off_ = true;
+        first_off_x_ = x;
+        first_off_y_ = y;
+      } else {
+        start((first_off_x_ + x) / 2, (first_off_y_ + y) / 2);
+        setControl(x, y);
+      }
+      return;
+    }
+
+    if (on_curve) {
+      if (has_control_)
+        sink_->quadTo(cx_, cy_, x, y);
+      else
+        sink_->lineTo(x, y);
+      has_control_ = false;
+    } else {
+      if (has_control_)
+        sink_->quadTo(cx_, cy_, (cx_ + x) / 2, (cy_ + y) / 2);
+      setControl(x, y);
+    }
+  }
+
+  // Ends the contour back at its start point.
+  void closeContour() {
+    if (!started_ && has_first_off_) {
+      // A single off curve point.
+      start(first_off_x_, first_off_y_);
+      has_first_off_ = false;
+    }
+    if (started_) {
+      if (has_first_off_)
+        addPoint(first_off_x_, first_off_y_, false);
+      if (has_control_)
+        sink_->quadTo(cx_, cy_, start_x_, start_y_);
+      sink_->close();
+    }
+    reset();
+  }
+
+ private:
+  void reset() {
+    started_ = false;
+    has_first_off_ = false;
+    has_control_ = false;
+  }
+
+  void start(int32_t x, int32_t y) {
+    started_ = true;
+    start_x_ = x;
+    start_y_ = y;
+    sink_->moveTo(x, y);
+  }
+
+  void setControl(int32_t x, int32_t y) {
+    has_control_ = true;
+    cx_ = x;
+    cy_ = y;
+  }
+
+  Sink* sink_;
+  bool started_;
+  bool has_first_off_;
+  bool has_control_;
+  int32_t start_x_, start_y_;
+  int32_t first_off_x_, first_off_y_;
+  int32_t cx_, cy_;
+};
+
+// Walks the contours of |outline| as path commands. See ContourDecomposer.
+template <typename Sink>
+void decomposeOutline(const Outline& outline, Sink* sink) {
+  ContourDecomposer<Sink> decomposer(sink);
+  for (size_t c = 0; c < outline.numContours(); ++c) {
+    for (size_t i = outline.contourStart(c); i <= outline.contour_ends[c]; ++i)
+      decomposer.addPoint(outline.x[i], outline.y[i], outline.isOnCurve(i));
+    decomposer.closeContour();
+  }
+}
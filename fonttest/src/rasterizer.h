@@ -1,38 +1,75 @@
 #pragma once
 
+#include "fixed.h"
 #include "glyf.h"
+#include "instructions.h"
+#include "outline.h"
+#include <stdint.h>
 #include <vector>
 
-class TrueType;
+class FontFace;
 class Gui;
 
+enum class RenderMode {
+  kMono,  // 0 or 1 for each pixel.
+  kGray,  // 8-bit coverage for each pixel.
+};
+
 class Rasterizer {
  public:
-  Rasterizer(int px, int unit_per_em, const TrueType& tt)
-      : Rasterizer(unit_per_em / px, tt) {}
-  explicit Rasterizer(int grid_size, const TrueType& tt)
-      : grid_size_(grid_size), tt_(tt) {}
-
-  void rasterize(const SimpleGlyphData& glyphData, std::vector<char>* out,
-                 int* x_pixel_num, Gui* gui);
-  bool isBitOn(
-      const SimpleGlyphData& glyph,
-      const std::vector<Contour>& resolved, int ix, int iy,
-      Gui* gui, bool debug_out);
-  bool isBitOnByRule2a(
-      const SimpleGlyphData& glyph,
-      const std::vector<Contour>& resolved, int ix, int iy,
-      Gui* gui, bool debug_out);
-
-  bool isBitOnByRule2b(
-      const SimpleGlyphData& glyph,
-      const std::vector<Contour>& resolved, int ix, int iy,
-      Gui* gui, bool debug_out);
+  Rasterizer(int px, int unit_per_em, const FontFace& face)
+      : Rasterizer(unit_per_em / px, face) {}
+  explicit Rasterizer(int grid_size, const FontFace& face);
+
+  void rasterize(const SimpleGlyphData& glyphData, RenderMode mode,
+                 std::vector<uint8_t>* out, int* x_pixel_num, Gui* gui);
+
+  // Rasterizes the simple glyph at |offset| of |glyf| without hinting,
+  // decoding the glyf bytes straight into the flattened lines. Returns false
+  // for a composite glyph or a broken record.
+  bool rasterizeUnhinted(const GlyfSubTable& glyf, uint32_t offset,
+                         RenderMode mode, std::vector<uint8_t>* out,
+                         int* x_pixel_num);
 
   int grid_size() const { return grid_size_; }
 
+  // The 16.16 scale from font units into 26.6 pixels, the same for the
+  // hinted and the unhinted glyphs.
+  F16Dot16 scale() const { return scale_; }
+
+  // The bottom left of the last bitmap in 26.6 pixels from the glyph origin.
+  F26Dot6 origin_x() const { return origin_x_; }
+  F26Dot6 origin_y() const { return origin_y_; }
+
+  // How the glyphs were hinted, counting the ones drawn unhinted because a
+  // hint program was stopped.
+  const HintStats& hint_stats() const { return hinter_.stats(); }
+
+  void setHintBudget(const HintBudget& budget) { hinter_.setBudget(budget); }
+
  private:
+  // Places the bitmap of the unhinted glyph at the scaled bottom left of
+  // |box| and sets |width| and |height| to the pixels covering the box.
+  void placeBox(const GlyfData& box, int* width, int* height);
+
+  // Renders |lines_| into |width| x |height| pixels.
+  void renderLines(RenderMode mode, const ScanControl& scan_control,
+                   int width, int height, std::vector<uint8_t>* out) const;
+
+  void rasterizeGray(const Outline& lines, int width, int height,
+                     std::vector<uint8_t>* out) const;
+
   int grid_size_;
-  const TrueType& tt_;
+  F16Dot16 scale_;
+  F26Dot6 origin_x_;
+  F26Dot6 origin_y_;
+  const FontFace& face_;
+  HintStackMachine hinter_;
+
+  // Reused for every glyph: the hinted outline, the outline in 26.6 pixels
+  // from the bottom left of the bitmap and its flattened lines.
+  Outline hinted_;
+  Outline scaled_;
+  Outline lines_;
 };
 
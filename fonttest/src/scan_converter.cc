@@ -0,0 +1,296 @@
+#include "scan_converter.h"
+
+#include <algorithm>
+
+namespace {
+
+// Returns the pixel index whose center is exactly on |pos|, or -1.
+int centerIndex(F26Dot6 pos, int n) {
+  F26Dot6 d = pos - kF26Dot6Half;
+  if (d < 0 || d % kF26Dot6One != 0 || d / kF26Dot6One >= n)
+    return -1;
+  return d / kF26Dot6One;
+}
+
+}  // namespace
+
+// A line crossing the scan lines, stepped by one scan line with the
+// remainder of the division kept in integers.
+struct ScanConverter::ActiveEdge {
+  const Edge* edge;
+  F26Dot6 hi;
+  int sign;
+  F26Dot6 x;
+  int64_t rem;
+  F26Dot6 step;
+  int64_t step_rem;
+  int64_t dy;
+
+  void start(F26Dot6 x0, F26Dot6 y0, F26Dot6 x1, F26Dot6 y1,
+             F26Dot6 scan_line) {
+    sign = y1 > y0 ? -1 : 1;
+    if (y0 > y1) {
+      std::swap(x0, x1);
+      std::swap(y0, y1);
+    }
+    hi = y1;
+    dy = y1 - y0;
+    int64_t dx = x1 - x0;
+    int64_t num = (scan_line - y0) * dx;
+    int64_t q = floorDiv(num, dy);
+    x = x0 + q;
+    rem = num - q * dy;
+    step = floorDiv(kF26Dot6One * dx, dy);
+    step_rem = kF26Dot6One * dx - step * dy;
+  }
+
+  void next() {
+    x += step;
+    rem += step_rem;
+    if (rem >= dy) {
+      ++x;
+      rem -= dy;
+    }
+  }
+};
+
+ScanConverter::ScanConverter(int x_grid_num, int y_grid_num)
+    : x_grid_num_(x_grid_num), y_grid_num_(y_grid_num),
+      dropout_mode_(kNoDropoutControl) {}
+
+void ScanConverter::addOutline(const Outline& lines) {
+  for (size_t c = 0; c < lines.numContours(); ++c) {
+    const size_t first = lines.contourStart(c);
+    const size_t last = lines.contour_ends[c];
+    rows_.contour_starts.push_back(rows_.edges.size());
+    columns_.contour_starts.push_back(columns_.edges.size());
+    for (size_t j = first; j <= last; ++j) {
+      const size_t prev = j == first ? last : j - 1;
+      F26Dot6 x0 = lines.x[prev];
+      F26Dot6 y0 = lines.y[prev];
+      F26Dot6 x1 = lines.x[j];
+      F26Dot6 y1 = lines.y[j];
+
+      // The pixel is on if the outline passes its center point.
+      int ix = centerIndex(x1, x_grid_num_);
+      int iy = centerIndex(y1, y_grid_num_);
+      if (ix >= 0 && iy >= 0)
+        center_pixels_.push_back(iy * x_grid_num_ + ix);
+
+      addEdge(x0, y0, x1, y1, &rows_);
+      addEdge(y0, x0, y1, x1, &columns_);
+    }
+  }
+  rows_.contour_starts.push_back(rows_.edges.size());
+  columns_.contour_starts.push_back(columns_.edges.size());
+
+  for (EdgeTable* table : { &rows_, &columns_ }) {
+    const std::vector<Edge>& edges = table->edges;
+    table->sorted.resize(edges.size());
+    for (size_t i = 0; i < edges.size(); ++i)
+      table->sorted[i] = i;
+    std::sort(table->sorted.begin(), table->sorted.end(),
+              [&edges](int a, int b) { return edges[a].lo < edges[b].lo; });
+  }
+}
+
+// static
+void ScanConverter::addEdge(F26Dot6 x0, F26Dot6 y0, F26Dot6 x1, F26Dot6 y1,
+                            EdgeTable* table) {
+  if (y0 == y1) {
+    // Parallel to the scan lines. Never crosses with them.
+    return;
+  }
+  int contour = table->contour_starts.size() - 1;
+  Edge edge = { x0, y0, x1, y1, std::min(y0, y1), std::max(y0, y1), contour };
+  table->edges.push_back(edge);
+}
+
+// The edge crosses the scan line y = s if lo <= s < hi.
+// static
+template <typename Visitor>
+void ScanConverter::traverse(const EdgeTable& table, int n, Visitor visitor) {
+  std::vector<ActiveEdge> active;
+  std::vector<Crossing> crossings;
+  size_t next_edge = 0;
+
+  for (int i = 0; i < n; ++i) {
+    F26Dot6 scan_line = i * kF26Dot6One + kF26Dot6Half;
+
+    for (size_t j = 0; j < active.size();) {
+      if (active[j].hi <= scan_line) {
+        active[j] = active.back();
+        active.pop_back();
+      } else {
+        active[j].next();
+        ++j;
+      }
+    }
+    for (; next_edge < table.sorted.size() &&
+           table.edges[table.sorted[next_edge]].lo <= scan_line;
+         ++next_edge) {
+      const Edge& edge = table.edges[table.sorted[next_edge]];
+      if (edge.hi <= scan_line)
+        continue;
+      ActiveEdge a;
+      a.edge = &edge;
+      a.start(edge.x0, edge.y0, edge.x1, edge.y1, scan_line);
+      active.push_back(a);
+    }
+
+    crossings.clear();
+    for (const ActiveEdge& a : active)
+      crossings.push_back({ a.x, a.sign, a.edge });
+    visitor(i, scan_line, &crossings);
+  }
+}
+
+// A stub is a dropout at the end of a stroke: the contour turns around
+// between the two crossings before it reaches the next scan line.
+// static
+bool ScanConverter::isStub(const Crossing& a, const Crossing& b,
+                           F26Dot6 scan_line, const EdgeTable& table) {
+  const Edge* ea = a.edge;
+  const Edge* eb = b.edge;
+  if (ea->contour != eb->contour)
+    return false;
+
+  const Edge* first = &table.edges[table.contour_starts[ea->contour]];
+  const Edge* last = &table.edges[table.contour_starts[ea->contour + 1] - 1];
+
+  // Walks the contour from one crossing edge to the other in both directions.
+  // The turn is on the way which does not cross the scan line.
+  for (int dir = 0; dir < 2; ++dir) {
+    const Edge* from = dir == 0 ? ea : eb;
+    const Edge* to = dir == 0 ? eb : ea;
+    F26Dot6 turn_lo = from->y1;
+    F26Dot6 turn_hi = from->y1;
+    bool crosses = false;
+    for (const Edge* e = from == last ? first : from + 1; e != to;
+         e = e == last ? first : e + 1) {
+      if (e->lo <= scan_line && scan_line < e->hi) {
+        crosses = true;
+        break;
+      }
+      turn_lo = std::min(turn_lo, e->lo);
+      turn_hi = std::max(turn_hi, e->hi);
+    }
+    if (crosses)
+      continue;
+
+    if (from->y1 > scan_line)
+      return turn_hi < scan_line + kF26Dot6One;
+    else
+      return turn_lo > scan_line - kF26Dot6One;
+  }
+  return false;
+}
+
+void ScanConverter::fillDropout(const Crossing& a, const Crossing& b,
+                                F26Dot6 scan_line, int n,
+                                const EdgeTable& table,
+                                uint8_t* pixels, int stride) const {
+  F26Dot6 lo = std::min(a.pos, b.pos);
+  F26Dot6 hi = std::max(a.pos, b.pos);
+
+  // The last pixel center left of the span.
+  int left = floorDiv(lo - kF26Dot6Half, kF26Dot6One);
+  F26Dot6 left_center = left * kF26Dot6One + kF26Dot6Half;
+  if (left_center >= lo || left_center + kF26Dot6One <= hi)
+    return;  // The span contains a pixel center.
+
+  int right = left + 1;
+  if ((left >= 0 && left < n && pixels[left * stride]) ||
+      (right >= 0 && right < n && pixels[right * stride]))
+    return;
+
+  if ((dropout_mode_ & 1) && isStub(a, b, scan_line, table))
+    return;
+
+  int pixel = left;
+  if ((dropout_mode_ & 4) && (lo + hi) / 2 - left_center > kF26Dot6Half) {
+    // Smart dropout control turns on the pixel closest to the span.
+    pixel = right;
+  }
+  if (pixel < 0 || pixel >= n)
+    pixel = pixel == left ? right : left;
+  if (pixel < 0 || pixel >= n)
+    return;
+  pixels[pixel * stride] = 1;
+}
+
+void ScanConverter::render(std::vector<uint8_t>* out) const {
+  out->assign(x_grid_num_ * y_grid_num_, 0);
+
+  for (int pixel : center_pixels_)
+    (*out)[pixel] = 1;
+
+  renderRows(out);
+  if (!(dropout_mode_ & kNoDropoutControl))
+    renderColumns(out);
+}
+
+// Fills the pixels whose center is inside the outline, then the dropouts on
+// the horizontal scan lines.
+void ScanConverter::renderRows(std::vector<uint8_t>* out) const {
+  const int x_grid_num = x_grid_num_;
+  const bool dropout_control = !(dropout_mode_ & kNoDropoutControl);
+
+  traverse(rows_, y_grid_num_,
+           [=](int iy, F26Dot6 scan_line, std::vector<Crossing>* crossings) {
+    // Right to left.
+    std::sort(crossings->begin(), crossings->end(),
+              [](const Crossing& a, const Crossing& b) {
+      return a.pos > b.pos;
+    });
+
+    uint8_t* row = &(*out)[iy * x_grid_num];
+    const size_t n = crossings->size();
+    size_t idx = 0;
+    int winding = 0;
+
+    // A crossing on the pixel center counts for the pixel.
+    for (int ix = x_grid_num - 1; ix >= 0; --ix) {
+      F26Dot6 c_grid_x = ix * kF26Dot6One + kF26Dot6Half;
+      for (; idx < n && (*crossings)[idx].pos >= c_grid_x; ++idx)
+        winding += (*crossings)[idx].sign;
+      if (winding != 0)
+        row[ix] = 1;
+    }
+
+    if (!dropout_control)
+      return;
+    winding = 0;
+    for (size_t i = 0; i + 1 < n; ++i) {
+      winding += (*crossings)[i].sign;
+      if (winding != 0) {
+        fillDropout((*crossings)[i], (*crossings)[i + 1], scan_line,
+                    x_grid_num, rows_, row, 1);
+      }
+    }
+  });
+}
+
+// Fills the dropouts on the vertical scan lines.
+void ScanConverter::renderColumns(std::vector<uint8_t>* out) const {
+  const int x_grid_num = x_grid_num_;
+  const int y_grid_num = y_grid_num_;
+
+  traverse(columns_, x_grid_num_,
+           [=](int ix, F26Dot6 scan_line, std::vector<Crossing>* crossings) {
+    std::sort(crossings->begin(), crossings->end(),
+              [](const Crossing& a, const Crossing& b) {
+      return a.pos < b.pos;
+    });
+
+    const size_t n = crossings->size();
+    int winding = 0;
+    for (size_t i = 0; i + 1 < n; ++i) {
+      winding += (*crossings)[i].sign;
+      if (winding != 0) {
+        fillDropout((*crossings)[i], (*crossings)[i + 1], scan_line,
+                    y_grid_num, columns_, &(*out)[ix], x_grid_num);
+      }
+    }
+  });
+}
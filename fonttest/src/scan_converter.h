@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "fixed.h"
+#include "outline.h"
+
+// Scan converts glyph contours into the Rasterizer pixel grid.
+//
+// The outline is in 26.6 pixels from the bottom left corner of the bitmap, so
+// the pixel centers are at 32 + 64 * n. The curves are already flattened and
+// all the lines are collected into an edge table once per glyph. Each
+// scan line only steps the edges whose extent covers it, and the pixels are
+// filled from the sorted crossings by the winding number. Everything is done
+// in integers.
+class ScanConverter {
+ public:
+  // The dropout mode is the SCANTYPE value. Bit 0 excludes stubs, bit 1
+  // disables the dropout control and bit 2 selects the smart dropout control.
+  static const int kNoDropoutControl = 2;
+
+  ScanConverter(int x_grid_num, int y_grid_num);
+
+  // |lines| is an outline with on curve points only.
+  void addOutline(const Outline& lines);
+
+  void set_dropout_mode(int mode) { dropout_mode_ = mode; }
+
+  void render(std::vector<uint8_t>* out) const;
+
+ private:
+  // A line from (x0, y0) to (x1, y1) in the contour order.
+  struct Edge {
+    F26Dot6 x0;
+    F26Dot6 y0;
+    F26Dot6 x1;
+    F26Dot6 y1;
+    F26Dot6 lo;
+    F26Dot6 hi;
+    int contour;
+  };
+
+  struct Crossing {
+    F26Dot6 pos;  // rounded down.
+    int sign;
+    const Edge* edge;
+  };
+
+  struct ActiveEdge;
+
+  struct EdgeTable {
+    std::vector<Edge> edges;  // in the contour order.
+    std::vector<int> sorted;  // edge indices sorted by lo.
+    std::vector<int> contour_starts;
+  };
+
+  static void addEdge(F26Dot6 x0, F26Dot6 y0, F26Dot6 x1, F26Dot6 y1,
+                      EdgeTable* table);
+
+  // Walks scan lines of the table with an active edge list.
+  template <typename Visitor>
+  static void traverse(const EdgeTable& table, int n, Visitor visitor);
+
+  static bool isStub(const Crossing& a, const Crossing& b, F26Dot6 scan_line,
+                     const EdgeTable& table);
+
+  // Turns on a pixel for the span between the adjacent crossings if the span
+  // does not contain any pixel center. |pixels| is the scan line with the
+  // |stride|.
+  void fillDropout(const Crossing& a, const Crossing& b, F26Dot6 scan_line,
+                   int n, const EdgeTable& table,
+                   uint8_t* pixels, int stride) const;
+
+  void renderRows(std::vector<uint8_t>* out) const;
+  void renderColumns(std::vector<uint8_t>* out) const;
+
+  int x_grid_num_;
+  int y_grid_num_;
+  int dropout_mode_;
+
+  // Edges for the horizontal scan lines and the same edges with x and y
+  // swapped for the vertical scan lines.
+  EdgeTable rows_;
+  EdgeTable columns_;
+
+  // The pixels whose center is exactly on a point of the outline.
+  std::vector<int> center_pixels_;
+};
@@ -10,6 +10,8 @@
 #include "prep.h"
 #include "fpgm.h"
 
+#include <algorithm>
+
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <fcntl.h>
@@ -17,6 +19,31 @@
 #include <sys/mman.h>
 #include <glog/logging.h>
 
+namespace {
+
+struct TtcHeader {
+  Tag ttc_tag;
+  UInt32 version;
+  UInt32 num_fonts;
+};
+
+struct TableDirectory {
+  UInt32 sfnt_version;
+  UInt16 num_tables;
+  UInt16 search_range;
+  UInt16 entry_selector;
+  UInt16 range_shift;
+};
+
+struct TableRecord {
+  Tag tag;
+  UInt32 check_sum;
+  Offset32 offset;
+  UInt32 length;
+};
+
+}  // namespace
+
 TrueType::TrueType(const std::string& fname, int index) {
   int fd = open(fname.c_str(), O_RDONLY);
   struct stat st = {};
@@ -36,10 +63,10 @@ TrueType::~TrueType() {
 }
 
 void TrueType::readHeader(int index) {
-  const size_t kOpenTypeHeaderSize = 12;
-  if (length_ < kOpenTypeHeaderSize)
+  const UInt32* sfnt_version = recordAt<UInt32>(ptr_, length_, 0);
+  if (!sfnt_version)
     LOG(FATAL) << "Invalid length of file";
-  uint32_t sfnt_ver = readU32(ptr_, 0);
+  uint32_t sfnt_ver = *sfnt_version;
 
   if (sfnt_ver == 0x00010000 || sfnt_ver == makeTag('O', 'T', 'T', 'O')) {
     if (index != 0)
@@ -49,44 +76,64 @@ void TrueType::readHeader(int index) {
     return;
   } else if (sfnt_ver == makeTag('t', 't', 'c', 'f')) {
     // Font Collection
-    uint32_t version = readU32(ptr_, 4);
+    const TtcHeader* header = recordAt<TtcHeader>(ptr_, length_, 0);
+    if (!header)
+      LOG(FATAL) << "Invalid length of file";
+    uint32_t version = header->version;
 
     if (version != 0x00010000 && version != 0x00020000)
       LOG(FATAL) << "Not supported version: " << std::hex << version;
 
-    uint32_t numFonts = readU32(ptr_, 8);
-    uint32_t offsetTableOffset = readU32(ptr_, 12 + 4 * index);
-    readOffsetTables(offsetTableOffset);
+    uint32_t numFonts = header->num_fonts;
+    const Offset32* offsets = recordAt<Offset32>(
+        ptr_, length_, sizeof(TtcHeader), numFonts);
+    if (!offsets || index < 0 || (uint32_t)index >= numFonts)
+      LOG(FATAL) << "Invalid font index: " << index;
+    readOffsetTables(offsets[index]);
   } else {
     LOG(FATAL) << "Unknown sfnt version: " << std::hex << sfnt_ver;
   }
 }
 
 void TrueType::readOffsetTables(size_t tblStartOffset) {
-  const size_t kOpenTypeHeaderSize = 12;
-  uint32_t sfnt_ver = readU32(ptr_, tblStartOffset);
+  const TableDirectory* directory =
+      recordAt<TableDirectory>(ptr_, length_, tblStartOffset);
+  if (!directory)
+    LOG(FATAL) << "Invalid length of file";
+  uint32_t sfnt_ver = directory->sfnt_version;
 
   if (sfnt_ver != 0x00010000 && sfnt_ver != makeTag('O', 'T', 'T', 'O'))
     LOG(FATAL) << "Invalid sfnt version: " << std::hex << sfnt_ver;
 
-  num_tables_ = readU16(ptr_, tblStartOffset + 4);
+  num_tables_ = directory->num_tables;
   if (num_tables_ == 0)
     LOG(FATAL) << "Table is empty";
-  if (length_ < num_tables_ * sizeof(OffsetTable) + kOpenTypeHeaderSize)
+  const TableRecord* records = recordAt<TableRecord>(
+      ptr_, length_, tblStartOffset + sizeof(TableDirectory), num_tables_);
+  if (!records)
     LOG(FATAL) << "Invalid length of file: less than offset table size";
-  range_shift_ = readU16(ptr_, tblStartOffset + 6);
-  entry_selector_ = readU16(ptr_, tblStartOffset + 8);
-  range_shift_ = readU16(ptr_, tblStartOffset + 10);
+  search_range_ = directory->search_range;
+  entry_selector_ = directory->entry_selector;
+  range_shift_ = directory->range_shift;
 
   tables_.resize(num_tables_);
 
   for (size_t i = 0; i < num_tables_; ++i) {
-    const size_t tableOffset = tblStartOffset + kOpenTypeHeaderSize + sizeof(OffsetTable) * i;
-    tables_[i].tag = readU32(ptr_, tableOffset);
-    tables_[i].check_sum = readU32(ptr_, tableOffset + 4);
-    tables_[i].offset = readU32(ptr_, tableOffset + 8);
-    tables_[i].length = readU32(ptr_, tableOffset + 12);
+    tables_[i].tag = records[i].tag;
+    tables_[i].check_sum = records[i].check_sum;
+    tables_[i].offset = records[i].offset;
+    tables_[i].length = records[i].length;
+    if (tables_[i].offset > length_ ||
+        tables_[i].length > length_ - tables_[i].offset) {
+      LOG(FATAL) << "Table out of the file: " << std::hex << tables_[i].tag;
+    }
   }
+
+  // Sorted by the tag for the binary search.
+  std::sort(tables_.begin(), tables_.end(),
+            [](const OffsetTable& a, const OffsetTable& b) {
+    return a.tag < b.tag;
+  });
 }
 
 void TrueType::dump() const {
@@ -104,13 +151,16 @@ void TrueType::dump() const {
 }
 
 const void* TrueType::getTable(uint32_t tag, size_t* length) const {
-  for (const OffsetTable& offset_table : tables_) {
-    if (offset_table.tag == tag) {
-      *length = offset_table.length;
-      return (uint8_t*)(ptr_) + offset_table.offset;
-    }
+  auto it = std::lower_bound(tables_.begin(), tables_.end(), tag,
+                             [](const OffsetTable& table, uint32_t tag) {
+    return table.tag < tag;
+  });
+  if (it == tables_.end() || it->tag != tag) {
+    *length = 0;
+    return nullptr;
   }
-  return nullptr;
+  *length = it->length;
+  return (uint8_t*)(ptr_) + it->offset;
 }
 
 std::unique_ptr<CmapSubTable> TrueType::getCmap() const {
@@ -16,6 +16,9 @@ class GlyfSubTable;
 class HeadSubTable;
 class PrepSubTable;
 class FpgmSubTable;
+class HheaSubTable;
+class HmtxSubTable;
+class Os2SubTable;
 
 class TrueType {
  public:
@@ -32,6 +35,7 @@ class TrueType {
   std::unique_ptr<PrepSubTable> getPrep() const;
   std::unique_ptr<CvtSubTable> getCvt() const;
 
+  // Returns nullptr and 0 |length| if the font does not have the table.
   const void* getTable(uint32_t tag, size_t* length) const;
   void dump() const;
 
@@ -1,3 +1,448 @@
 #pragma once
 
+#include <stdint.h>
 
+// The TrueType instructions as V(name, variant, opcode). The opcodes not
+// listed are not instructions unless IDEF defines them.
+#define FOR_EACH_INSTRUCTIONS(V) \
+    V(SVTCA, 0, 0x00) \
+    V(SVTCA, 1, 0x01) \
+    V(SPVTCA, 0, 0x02) \
+    V(SPVTCA, 1, 0x03) \
+    V(SFVTCA, 0, 0x04) \
+    V(SFVTCA, 1, 0x05) \
+    V(SPVTL, 0, 0x06) \
+    V(SPVTL, 1, 0x07) \
+    V(SFVTL, 0, 0x08) \
+    V(SFVTL, 1, 0x09) \
+    V(SPVFS, 0, 0x0A) \
+    V(SFVFS, 0, 0x0B) \
+    V(GPV, 0, 0x0C) \
+    V(GFV, 0, 0x0D) \
+    V(SFVTPV, 0, 0x0E) \
+    V(ISECT, 0, 0x0F) \
+    V(SRP0, 0, 0x10) \
+    V(SRP1, 0, 0x11) \
+    V(SRP2, 0, 0x12) \
+    V(SZP0, 0, 0x13) \
+    V(SZP1, 0, 0x14) \
+    V(SZP2, 0, 0x15) \
+    V(SZPS, 0, 0x16) \
+    V(SLOOP, 0, 0x17) \
+    V(RTG, 0, 0x18) \
+    V(RTHG, 0, 0x19) \
+    V(SMD, 0, 0x1A) \
+    V(ELSE, 0, 0x1B) \
+    V(JMPR, 0, 0x1C) \
+    V(SCVTCI, 0, 0x1D) \
+    V(SSWCI, 0, 0x1E) \
+    V(SSW, 0, 0x1F) \
+    V(DUP, 0, 0x20) \
+    V(POP, 0, 0x21) \
+    V(CLEAR, 0, 0x22) \
+    V(SWAP, 0, 0x23) \
+    V(DEPTH, 0, 0x24) \
+    V(CINDEX, 0, 0x25) \
+    V(MINDEX, 0, 0x26) \
+    V(ALIGNPTS, 0, 0x27) \
+    V(UTP, 0, 0x29) \
+    V(LOOPCALL, 0, 0x2A) \
+    V(CALL, 0, 0x2B) \
+    V(FDEF, 0, 0x2C) \
+    V(ENDF, 0, 0x2D) \
+    V(MDAP, 0, 0x2E) \
+    V(MDAP, 1, 0x2F) \
+    V(IUP, 0, 0x30) \
+    V(IUP, 1, 0x31) \
+    V(SHP, 0, 0x32) \
+    V(SHP, 1, 0x33) \
+    V(SHC, 0, 0x34) \
+    V(SHC, 1, 0x35) \
+    V(SHZ, 0, 0x36) \
+    V(SHZ, 1, 0x37) \
+    V(SHPIX, 0, 0x38) \
+    V(IP, 0, 0x39) \
+    V(MSIRP, 0, 0x3A) \
+    V(MSIRP, 1, 0x3B) \
+    V(ALIGNRP, 0, 0x3C) \
+    V(RTDG, 0, 0x3D) \
+    V(MIAP, 0, 0x3E) \
+    V(MIAP, 1, 0x3F) \
+    V(NPUSHB, 0, 0x40) \
+    V(NPUSHW, 0, 0x41) \
+    V(WS, 0, 0x42) \
+    V(RS, 0, 0x43) \
+    V(WCVTP, 0, 0x44) \
+    V(RCVT, 0, 0x45) \
+    V(GC, 0, 0x46) \
+    V(GC, 1, 0x47) \
+    V(SCFS, 0, 0x48) \
+    V(MD, 0, 0x49) \
+    V(MD, 1, 0x4A) \
+    V(MPPEM, 0, 0x4B) \
+    V(MPS, 0, 0x4C) \
+    V(FLIPON, 0, 0x4D) \
+    V(FLIPOFF, 0, 0x4E) \
+    V(DEBUG, 0, 0x4F) \
+    V(LT, 0, 0x50) \
+    V(LTEQ, 0, 0x51) \
+    V(GT, 0, 0x52) \
+    V(GTEQ, 0, 0x53) \
+    V(EQ, 0, 0x54) \
+    V(NEQ, 0, 0x55) \
+    V(ODD, 0, 0x56) \
+    V(EVEN, 0, 0x57) \
+    V(IF, 0, 0x58) \
+    V(EIF, 0, 0x59) \
+    V(AND, 0, 0x5A) \
+    V(OR, 0, 0x5B) \
+    V(NOT, 0, 0x5C) \
+    V(DELTAP1, 0, 0x5D) \
+    V(SDB, 0, 0x5E) \
+    V(SDS, 0, 0x5F) \
+    V(ADD, 0, 0x60) \
+    V(SUB, 0, 0x61) \
+    V(DIV, 0, 0x62) \
+    V(MUL, 0, 0x63) \
+    V(ABS, 0, 0x64) \
+    V(NEG, 0, 0x65) \
+    V(FLOOR, 0, 0x66) \
+    V(CEILING, 0, 0x67) \
+    V(ROUND, 00, 0x68) \
+    V(ROUND, 01, 0x69) \
+    V(ROUND, 10, 0x6A) \
+    V(ROUND, 11, 0x6B) \
+    V(NROUND, 00, 0x6C) \
+    V(NROUND, 01, 0x6D) \
+    V(NROUND, 10, 0x6E) \
+    V(NROUND, 11, 0x6F) \
+    V(WCVTF, 0, 0x70) \
+    V(DELTAP2, 0, 0x71) \
+    V(DELTAP3, 0, 0x72) \
+    V(DELTAC1, 0, 0x73) \
+    V(DELTAC2, 0, 0x74) \
+    V(DELTAC3, 0, 0x75) \
+    V(SROUND, 0, 0x76) \
+    V(S45ROUND, 0, 0x77) \
+    V(JROT, 0, 0x78) \
+    V(JROF, 0, 0x79) \
+    V(ROFF, 0, 0x7A) \
+    V(RUTG, 0, 0x7C) \
+    V(RDTG, 0, 0x7D) \
+    V(SANGW, 0, 0x7E) \
+    V(AA, 0, 0x7F) \
+    V(FLIPPT, 0, 0x80) \
+    V(FLIPRGON, 0, 0x81) \
+    V(FLIPRGOFF, 0, 0x82) \
+    V(SCANCTRL, 0, 0x85) \
+    V(SDPVTL, 0, 0x86) \
+    V(SDPVTL, 1, 0x87) \
+    V(GETINFO, 0, 0x88) \
+    V(IDEF, 0, 0x89) \
+    V(ROLL, 0, 0x8A) \
+    V(MAX, 0, 0x8B) \
+    V(MIN, 0, 0x8C) \
+    V(SCANTYPE, 0, 0x8D) \
+    V(INSTCTRL, 0, 0x8E) \
+    V(PUSHB, 000, 0xB0) \
+    V(PUSHB, 001, 0xB1) \
+    V(PUSHB, 010, 0xB2) \
+    V(PUSHB, 011, 0xB3) \
+    V(PUSHB, 100, 0xB4) \
+    V(PUSHB, 101, 0xB5) \
+    V(PUSHB, 110, 0xB6) \
+    V(PUSHB, 111, 0xB7) \
+    V(PUSHW, 000, 0xB8) \
+    V(PUSHW, 001, 0xB9) \
+    V(PUSHW, 010, 0xBA) \
+    V(PUSHW, 011, 0xBB) \
+    V(PUSHW, 100, 0xBC) \
+    V(PUSHW, 101, 0xBD) \
+    V(PUSHW, 110, 0xBE) \
+    V(PUSHW, 111, 0xBF) \
+    V(MDRP, 00000, 0xC0) \
+    V(MDRP, 00001, 0xC1) \
+    V(MDRP, 00010, 0xC2) \
+    V(MDRP, 00011, 0xC3) \
+    V(MDRP, 00100, 0xC4) \
+    V(MDRP, 00101, 0xC5) \
+    V(MDRP, 00110, 0xC6) \
+    V(MDRP, 00111, 0xC7) \
+    V(MDRP, 01000, 0xC8) \
+    V(MDRP, 01001, 0xC9) \
+    V(MDRP, 01010, 0xCA) \
+    V(MDRP, 01011, 0xCB) \
+    V(MDRP, 01100, 0xCC) \
+    V(MDRP, 01101, 0xCD) \
+    V(MDRP, 01110, 0xCE) \
+    V(MDRP, 01111, 0xCF) \
+    V(MDRP, 10000, 0xD0) \
+    V(MDRP, 10001, 0xD1) \
+    V(MDRP, 10010, 0xD2) \
+    V(MDRP, 10011, 0xD3) \
+    V(MDRP, 10100, 0xD4) \
+    V(MDRP, 10101, 0xD5) \
+    V(MDRP, 10110, 0xD6) \
+    V(MDRP, 10111, 0xD7) \
+    V(MDRP, 11000, 0xD8) \
+    V(MDRP, 11001, 0xD9) \
+    V(MDRP, 11010, 0xDA) \
+    V(MDRP, 11011, 0xDB) \
+    V(MDRP, 11100, 0xDC) \
+    V(MDRP, 11101, 0xDD) \
+    V(MDRP, 11110, 0xDE) \
+    V(MDRP, 11111, 0xDF) \
+    V(MIRP, 00000, 0xE0) \
+    V(MIRP, 00001, 0xE1) \
+    V(MIRP, 00010, 0xE2) \
+    V(MIRP, 00011, 0xE3) \
+    V(MIRP, 00100, 0xE4) \
+    V(MIRP, 00101, 0xE5) \
+    V(MIRP, 00110, 0xE6) \
+    V(MIRP, 00111, 0xE7) \
+    V(MIRP, 01000, 0xE8) \
+    V(MIRP, 01001, 0xE9) \
+    V(MIRP, 01010, 0xEA) \
+    V(MIRP, 01011, 0xEB) \
+    V(MIRP, 01100, 0xEC) \
+    V(MIRP, 01101, 0xED) \
+    V(MIRP, 01110, 0xEE) \
+    V(MIRP, 01111, 0xEF) \
+    V(MIRP, 10000, 0xF0) \
+    V(MIRP, 10001, 0xF1) \
+    V(MIRP, 10010, 0xF2) \
+    V(MIRP, 10011, 0xF3) \
+    V(MIRP, 10100, 0xF4) \
+    V(MIRP, 10101, 0xF5) \
+    V(MIRP, 10110, 0xF6) \
+    V(MIRP, 10111, 0xF7) \
+    V(MIRP, 11000, 0xF8) \
+    V(MIRP, 11001, 0xF9) \
+    V(MIRP, 11010, 0xFA) \
+    V(MIRP, 11011, 0xFB) \
+    V(MIRP, 11100, 0xFC) \
+    V(MIRP, 11101, 0xFD) \
+    V(MIRP, 11110, 0xFE) \
+    V(MIRP, 11111, 0xFF) \
+
+// The stack effects and the branches of the instructions by name, as
+// V(name, pops, pushes, operand_bytes, effect, branch).
+#define FOR_EACH_INSTRUCTION_EFFECTS(V) \
+    V(SVTCA, 0, 0, 0, kFixed, kNone) \
+    V(SPVTCA, 0, 0, 0, kFixed, kNone) \
+    V(SFVTCA, 0, 0, 0, kFixed, kNone) \
+    V(SPVTL, 2, 0, 0, kFixed, kNone) \
+    V(SFVTL, 2, 0, 0, kFixed, kNone) \
+    V(SPVFS, 2, 0, 0, kFixed, kNone) \
+    V(SFVFS, 2, 0, 0, kFixed, kNone) \
+    V(GPV, 0, 2, 0, kFixed, kNone) \
+    V(GFV, 0, 2, 0, kFixed, kNone) \
+    V(SFVTPV, 0, 0, 0, kFixed, kNone) \
+    V(ISECT, 5, 0, 0, kFixed, kNone) \
+    V(SRP0, 1, 0, 0, kFixed, kNone) \
+    V(SRP1, 1, 0, 0, kFixed, kNone) \
+    V(SRP2, 1, 0, 0, kFixed, kNone) \
+    V(SZP0, 1, 0, 0, kFixed, kNone) \
+    V(SZP1, 1, 0, 0, kFixed, kNone) \
+    V(SZP2, 1, 0, 0, kFixed, kNone) \
+    V(SZPS, 1, 0, 0, kFixed, kNone) \
+    V(SLOOP, 1, 0, 0, kFixed, kNone) \
+    V(RTG, 0, 0, 0, kFixed, kNone) \
+    V(RTHG, 0, 0, 0, kFixed, kNone) \
+    V(SMD, 1, 0, 0, kFixed, kNone) \
+    V(ELSE, 0, 0, 0, kFixed, kElse) \
+    V(JMPR, 1, 0, 0, kFixed, kJump) \
+    V(SCVTCI, 1, 0, 0, kFixed, kNone) \
+    V(SSWCI, 1, 0, 0, kFixed, kNone) \
+    V(SSW, 1, 0, 0, kFixed, kNone) \
+    V(DUP, 1, 2, 0, kFixed, kNone) \
+    V(POP, 1, 0, 0, kFixed, kNone) \
+    V(CLEAR, 0, 0, 0, kClear, kNone) \
+    V(SWAP, 2, 2, 0, kFixed, kNone) \
+    V(DEPTH, 0, 1, 0, kFixed, kNone) \
+    V(CINDEX, 1, 1, 0, kIndex, kNone) \
+    V(MINDEX, 1, 0, 0, kIndex, kNone) \
+    V(ALIGNPTS, 2, 0, 0, kFixed, kNone) \
+    V(UTP, 1, 0, 0, kFixed, kNone) \
+    V(LOOPCALL, 2, 0, 0, kFixed, kCall) \
+    V(CALL, 1, 0, 0, kFixed, kCall) \
+    V(FDEF, 1, 0, 0, kFixed, kDefinition) \
+    V(ENDF, 0, 0, 0, kFixed, kEndDefinition) \
+    V(MDAP, 1, 0, 0, kFixed, kNone) \
+    V(IUP, 0, 0, 0, kFixed, kNone) \
+    V(SHP, 0, 0, 0, kLoop, kNone) \
+    V(SHC, 1, 0, 0, kFixed, kNone) \
+    V(SHZ, 1, 0, 0, kFixed, kNone) \
+    V(SHPIX, 1, 0, 0, kLoop, kNone) \
+    V(IP, 0, 0, 0, kLoop, kNone) \
+    V(MSIRP, 2, 0, 0, kFixed, kNone) \
+    V(ALIGNRP, 0, 0, 0, kLoop, kNone) \
+    V(RTDG, 0, 0, 0, kFixed, kNone) \
+    V(MIAP, 2, 0, 0, kFixed, kNone) \
+    V(NPUSHB, 0, 0, 1, kPush, kNone) \
+    V(NPUSHW, 0, 0, 2, kPush, kNone) \
+    V(WS, 2, 0, 0, kFixed, kNone) \
+    V(RS, 1, 1, 0, kFixed, kNone) \
+    V(WCVTP, 2, 0, 0, kFixed, kNone) \
+    V(RCVT, 1, 1, 0, kFixed, kNone) \
+    V(GC, 1, 1, 0, kFixed, kNone) \
+    V(SCFS, 2, 0, 0, kFixed, kNone) \
+    V(MD, 2, 1, 0, kFixed, kNone) \
+    V(MPPEM, 0, 1, 0, kFixed, kNone) \
+    V(MPS, 0, 1, 0, kFixed, kNone) \
+    V(FLIPON, 0, 0, 0, kFixed, kNone) \
+    V(FLIPOFF, 0, 0, 0, kFixed, kNone) \
+    V(DEBUG, 1, 0, 0, kFixed, kNone) \
+    V(LT, 2, 1, 0, kFixed, kNone) \
+    V(LTEQ, 2, 1, 0, kFixed, kNone) \
+    V(GT, 2, 1, 0, kFixed, kNone) \
+    V(GTEQ, 2, 1, 0, kFixed, kNone) \
+    V(EQ, 2, 1, 0, kFixed, kNone) \
+    V(NEQ, 2, 1, 0, kFixed, kNone) \
+    V(ODD, 1, 1, 0, kFixed, kNone) \
+    V(EVEN, 1, 1, 0, kFixed, kNone) \
+    V(IF, 1, 0, 0, kFixed, kIf) \
+    V(EIF, 0, 0, 0, kFixed, kEndIf) \
+    V(AND, 2, 1, 0, kFixed, kNone) \
+    V(OR, 2, 1, 0, kFixed, kNone) \
+    V(NOT, 1, 1, 0, kFixed, kNone) \
+    V(DELTAP1, 1, 0, 0, kDelta, kNone) \
+    V(SDB, 1, 0, 0, kFixed, kNone) \
+    V(SDS, 1, 0, 0, kFixed, kNone) \
+    V(ADD, 2, 1, 0, kFixed, kNone) \
+    V(SUB, 2, 1, 0, kFixed, kNone) \
+    V(DIV, 2, 1, 0, kFixed, kNone) \
+    V(MUL, 2, 1, 0, kFixed, kNone) \
+    V(ABS, 1, 1, 0, kFixed, kNone) \
+    V(NEG, 1, 1, 0, kFixed, kNone) \
+    V(FLOOR, 1, 1, 0, kFixed, kNone) \
+    V(CEILING, 1, 1, 0, kFixed, kNone) \
+    V(ROUND, 1, 1, 0, kFixed, kNone) \
+    V(NROUND, 1, 1, 0, kFixed, kNone) \
+    V(WCVTF, 2, 0, 0, kFixed, kNone) \
+    V(DELTAP2, 1, 0, 0, kDelta, kNone) \
+    V(DELTAP3, 1, 0, 0, kDelta, kNone) \
+    V(DELTAC1, 1, 0, 0, kDelta, kNone) \
+    V(DELTAC2, 1, 0, 0, kDelta, kNone) \
+    V(DELTAC3, 1, 0, 0, kDelta, kNone) \
+    V(SROUND, 1, 0, 0, kFixed, kNone) \
+    V(S45ROUND, 1, 0, 0, kFixed, kNone) \
+    V(JROT, 2, 0, 0, kFixed, kJump) \
+    V(JROF, 2, 0, 0, kFixed, kJump) \
+    V(ROFF, 0, 0, 0, kFixed, kNone) \
+    V(RUTG, 0, 0, 0, kFixed, kNone) \
+    V(RDTG, 0, 0, 0, kFixed, kNone) \
+    V(SANGW, 1, 0, 0, kFixed, kNone) \
+    V(AA, 1, 0, 0, kFixed, kNone) \
+    V(FLIPPT, 0, 0, 0, kLoop, kNone) \
+    V(FLIPRGON, 2, 0, 0, kFixed, kNone) \
+    V(FLIPRGOFF, 2, 0, 0, kFixed, kNone) \
+    V(SCANCTRL, 1, 0, 0, kFixed, kNone) \
+    V(SDPVTL, 2, 0, 0, kFixed, kNone) \
+    V(GETINFO, 1, 1, 0, kFixed, kNone) \
+    V(IDEF, 1, 0, 0, kFixed, kDefinition) \
+    V(ROLL, 3, 3, 0, kFixed, kNone) \
+    V(MAX, 2, 1, 0, kFixed, kNone) \
+    V(MIN, 2, 1, 0, kFixed, kNone) \
+    V(SCANTYPE, 1, 0, 0, kFixed, kNone) \
+    V(INSTCTRL, 2, 0, 0, kFixed, kNone) \
+    V(PUSHB, 0, 0, 1, kPush, kNone) \
+    V(PUSHW, 0, 0, 2, kPush, kNone) \
+    V(MDRP, 1, 0, 0, kFixed, kNone) \
+    V(MIRP, 2, 0, 0, kFixed, kNone)
+
+// How an instruction changes the stack besides popping |pops| values and
+// pushing |pushes| values.
+enum class StackEffect : uint8_t {
+  kFixed,
+  // Pushes its inline values, as many as the opcode or the first inline
+  // byte says.
+  kPush,
+  // Pops a point more for each time set by SLOOP.
+  kLoop,
+  // Pops the pairs counted by its first argument.
+  kDelta,
+  // Reaches as deep into the stack as its first argument.
+  kIndex,
+  // Empties the stack.
+  kClear,
+  // Not an instruction.
+  kUndefined,
+};
+
+// How an instruction moves to the next one other than by falling through.
+enum class BranchKind : uint8_t {
+  kNone,
+  kIf,
+  kElse,
+  kEndIf,
+  // FDEF and IDEF, which skip to the end of the definition.
+  kDefinition,
+  kEndDefinition,
+  kCall,
+  // The relative jumps, whose targets are known only when running.
+  kJump,
+};
+
+struct InstructionInfo {
+  uint8_t pops;
+  uint8_t pushes;
+  // The size of each inline value of the push instructions.
+  uint8_t operand_bytes;
+  StackEffect effect;
+  BranchKind branch;
+};
+
+#define V(name, pops, pushes, operand_bytes, effect, branch) \
+  constexpr InstructionInfo k##name##Info = { \
+    pops, pushes, operand_bytes, StackEffect::effect, BranchKind::branch };
+FOR_EACH_INSTRUCTION_EFFECTS(V)
+#undef V
+
+constexpr InstructionInfo kUndefinedInfo = {
+  0, 0, 0, StackEffect::kUndefined, BranchKind::kNone
+};
+
+// PUSHB and PUSHW push one to eight values by the opcode. NPUSHB and NPUSHW
+// read the count from the first inline byte and keep |pushes| zero.
+constexpr InstructionInfo withOpcode(const InstructionInfo& info, int opcode) {
+  return info.effect == StackEffect::kPush && opcode >= 0xB0
+      ? InstructionInfo{ info.pops, (uint8_t)((opcode & 7) + 1),
+                         info.operand_bytes, info.effect, info.branch }
+      : info;
+}
+
+constexpr InstructionInfo instructionInfo(int opcode) {
+  return
+#define V(name, variant, code) \
+      opcode == code ? withOpcode(k##name##Info, code) :
+      FOR_EACH_INSTRUCTIONS(V)
+#undef V
+      kUndefinedInfo;
+}
+
+#define INSTRUCTION_INFO4(n) \
+    instructionInfo(n), instructionInfo(n + 1), instructionInfo(n + 2), \
+    instructionInfo(n + 3)
+#define INSTRUCTION_INFO16(n) \
+    INSTRUCTION_INFO4(n), INSTRUCTION_INFO4(n + 4), \
+    INSTRUCTION_INFO4(n + 8), INSTRUCTION_INFO4(n + 12)
+
+// The InstructionInfo of every opcode, built at compile time.
+constexpr InstructionInfo kInstructionInfo[256] = {
+  INSTRUCTION_INFO16(0x00), INSTRUCTION_INFO16(0x10),
+  INSTRUCTION_INFO16(0x20), INSTRUCTION_INFO16(0x30),
+  INSTRUCTION_INFO16(0x40), INSTRUCTION_INFO16(0x50),
+  INSTRUCTION_INFO16(0x60), INSTRUCTION_INFO16(0x70),
+  INSTRUCTION_INFO16(0x80), INSTRUCTION_INFO16(0x90),
+  INSTRUCTION_INFO16(0xA0), INSTRUCTION_INFO16(0xB0),
+  INSTRUCTION_INFO16(0xC0), INSTRUCTION_INFO16(0xD0),
+  INSTRUCTION_INFO16(0xE0), INSTRUCTION_INFO16(0xF0),
+};
+
+#undef INSTRUCTION_INFO16
+#undef INSTRUCTION_INFO4
+
+static_assert(kInstructionInfo[0xB3].pushes == 4, "PUSHB[011] pushes four");
+static_assert(kInstructionInfo[0x28].effect == StackEffect::kUndefined,
+              "0x28 is not an instruction");
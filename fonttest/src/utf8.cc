@@ -0,0 +1,104 @@
+#include "utf8.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Widens the ASCII bytes from |src| while they are ASCII. Returns the number
+// of bytes copied.
+size_t copyAscii(const uint8_t* src, size_t length, uint32_t* dst) {
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= length; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+    if (_mm_movemask_epi8(v))
+      break;
+    __m128i lo = _mm_unpacklo_epi8(v, zero);
+    __m128i hi = _mm_unpackhi_epi8(v, zero);
+    _mm_storeu_si128((__m128i*)(dst + i), _mm_unpacklo_epi16(lo, zero));
+    _mm_storeu_si128((__m128i*)(dst + i + 4), _mm_unpackhi_epi16(lo, zero));
+    _mm_storeu_si128((__m128i*)(dst + i + 8), _mm_unpacklo_epi16(hi, zero));
+    _mm_storeu_si128((__m128i*)(dst + i + 12), _mm_unpackhi_epi16(hi, zero));
+  }
+#endif
+  for (; i < length && src[i] < 0x80; ++i)
+    dst[i] = src[i];
+  return i;
+}
+
+// Decodes a multi byte sequence at |src| into |*ch| and its byte count into
+// |*size|. Returns false with U+FFFD and the byte count of the malformed
+// prefix.
+bool decodeSequence(const uint8_t* src, size_t length, uint32_t* ch,
+                    size_t* size) {
+  uint8_t lead = src[0];
+  size_t n;
+  // The range of the second byte excludes overlong forms, surrogates and
+  // values above U+10FFFF.
+  uint8_t lo = 0x80;
+  uint8_t hi = 0xBF;
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    n = 2;
+    *ch = lead & 0x1F;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    n = 3;
+    *ch = lead & 0x0F;
+    if (lead == 0xE0)
+      lo = 0xA0;
+    else if (lead == 0xED)
+      hi = 0x9F;
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    n = 4;
+    *ch = lead & 0x07;
+    if (lead == 0xF0)
+      lo = 0x90;
+    else if (lead == 0xF4)
+      hi = 0x8F;
+  } else {
+    *ch = kReplacementCharacter;
+    *size = 1;
+    return false;
+  }
+
+  for (size_t i = 1; i < n; ++i) {
+    if (i >= length || src[i] < lo || src[i] > hi) {
+      *ch = kReplacementCharacter;
+      *size = i;
+      return false;
+    }
+    *ch = (*ch << 6) | (src[i] & 0x3F);
+    lo = 0x80;
+    hi = 0xBF;
+  }
+  *size = n;
+  return true;
+}
+
+}  // namespace
+
+bool decodeUtf8(const char* text, size_t length, std::vector<uint32_t>* out) {
+  const uint8_t* src = (const uint8_t*)text;
+  size_t base = out->size();
+  // No more code points than bytes.
+  out->resize(base + length);
+  uint32_t* dst = out->data() + base;
+  bool valid = true;
+
+  size_t i = 0;
+  while (i < length) {
+    size_t ascii = copyAscii(src + i, length - i, dst);
+    i += ascii;
+    dst += ascii;
+    if (i == length)
+      break;
+    size_t n;
+    valid &= decodeSequence(src + i, length - i, dst, &n);
+    i += n;
+    ++dst;
+  }
+  out->resize(dst - out->data());
+  return valid;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+const uint32_t kReplacementCharacter = 0xFFFD;
+
+// Decodes |length| bytes of UTF-8 |text| into code points appended to |out|.
+// Each maximal malformed subsequence, such as an overlong form, a surrogate,
+// a value above U+10FFFF or a truncated sequence, becomes one U+FFFD.
+// Returns false if there was any.
+bool decodeUtf8(const char* text, size_t length, std::vector<uint32_t>* out);
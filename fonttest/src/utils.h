@@ -4,11 +4,22 @@
 #include <stddef.h>
 #include <string>
 
+#include "big_endian.h"
+
 uint32_t makeTag(char c1, char c2, char c3, char c4);
 
-uint32_t readU32(const void* ptr, size_t offset);
-uint32_t readU24(const void* ptr, size_t offset);
-uint16_t readU16(const void* ptr, size_t offset);
+inline uint32_t readU32(const void* ptr, size_t offset) {
+  return *recordAt<UInt32>(ptr, offset);
+}
+
+inline uint32_t readU24(const void* ptr, size_t offset) {
+  return *recordAt<UInt24>(ptr, offset);
+}
 
-uint16_t readS16(const void* ptr, size_t offset);
+inline uint16_t readU16(const void* ptr, size_t offset) {
+  return *recordAt<UInt16>(ptr, offset);
+}
 
+inline int16_t readS16(const void* ptr, size_t offset) {
+  return *recordAt<Int16>(ptr, offset);
+}